@@ -0,0 +1,53 @@
+//
+// bench.h
+// Passageways
+//
+// Timing helpers shared by the programs in bench/. Each program is built
+// on its own from this directory, for instance:
+//
+//     g++ -std=c++11 -O2 -I.. -pthread parallel_algorithm.cpp -o parallel_algorithm
+//
+
+#ifndef __OBJ_BENCH_H__
+#define __OBJ_BENCH_H__
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdio>
+
+namespace bench
+{
+    // Best of runs timings of fn, in nanoseconds. The best run is the one
+    // least disturbed by the rest of the machine.
+    template<class Fn>
+    double best_ns(std::size_t runs, Fn fn)
+    {
+        double best = 0;
+
+        for (std::size_t i = 0; i < runs; ++i)
+        {
+            auto start = std::chrono::steady_clock::now();
+
+            fn();
+
+            std::chrono::duration<double, std::nano> elapsed =
+                std::chrono::steady_clock::now() - start;
+
+            best = i == 0 ? elapsed.count() : std::min(best, elapsed.count());
+        }
+
+        return best;
+    }
+
+    static const void* volatile sink;
+
+    // Keeps the optimizer from discarding a result.
+    template<class T>
+    void keep(const T& val)
+    {
+        sink = &val;
+    }
+}
+
+#endif
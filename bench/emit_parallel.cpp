@@ -0,0 +1,112 @@
+//
+// emit_parallel.cpp
+// Passageways
+//
+// Serial emission against signal::emit_parallel() for a range of slot
+// counts and per-slot costs, reporting the smallest slot count at which
+// the parallel emission is at least 10% faster: the threshold to pass for
+// slots of that cost on this machine.
+//
+//     g++ -std=c++11 -O2 -I.. -pthread emit_parallel.cpp -o emit_parallel
+//     ./emit_parallel [threads]
+//
+
+#include "bench.h"
+
+#include <obj_signal.h>
+#include <obj_thread_pool.h>
+
+#include <cstdlib>
+#include <thread>
+#include <vector>
+
+namespace
+{
+    volatile std::size_t spin_sink;
+
+    void spin(std::size_t iterations)
+    {
+        std::size_t x = 0;
+
+        for (std::size_t i = 0; i < iterations; ++i)
+        {
+            x = x * 31 + i;
+        }
+
+        spin_sink = x;
+    }
+
+    // Iterations of spin() taking about one microsecond.
+    std::size_t iterations_per_us()
+    {
+        std::size_t iterations = 1000000;
+
+        double ns = bench::best_ns(5, [iterations]() { spin(iterations); });
+
+        return std::max<std::size_t>(static_cast<std::size_t>(iterations * 1000 / ns), 1);
+    }
+}
+
+int main(int argc, char** argv)
+{
+    std::size_t threads = argc > 1 ? std::strtoul(argv[1], nullptr, 10) :
+                                     std::max<std::size_t>(std::thread::hardware_concurrency(), 1);
+    std::size_t runs = 20;
+    std::size_t perUs = iterations_per_us();
+
+    // A pool of threads - 1 workers: the emitting thread runs slots too.
+    obj::thread_pool pool(threads - 1);
+
+    const double costs[] = { 0.25, 1, 4, 16, 64 };
+    const std::size_t maxSlots = 1024;
+
+    std::printf("%zu threads; time of emit_parallel / serial emission\n", threads);
+    std::printf("%10s", "slot cost");
+
+    for (std::size_t slots = 1; slots <= maxSlots; slots *= 2)
+    {
+        std::printf("%6zu", slots);
+    }
+
+    std::printf("  crossover\n");
+
+    for (double cost : costs)
+    {
+        std::size_t iterations = static_cast<std::size_t>(cost * perUs);
+        std::size_t crossover = 0;
+
+        std::printf("%8.2fus", cost);
+
+        for (std::size_t slots = 1; slots <= maxSlots; slots *= 2)
+        {
+            obj::signal<void(int)> sig;
+            std::vector<obj::connection> connections;
+
+            for (std::size_t i = 0; i < slots; ++i)
+            {
+                connections.push_back(sig.connect([iterations](int) { spin(iterations); }));
+            }
+
+            double serial = bench::best_ns(runs, [&]() { sig(1); });
+            double parallel = bench::best_ns(runs, [&]() { sig.emit_parallel(pool, 0, 1); });
+
+            std::printf("%6.2f", parallel / serial);
+
+            if (crossover == 0 && parallel < serial * 0.9)
+            {
+                crossover = slots;
+            }
+        }
+
+        if (crossover)
+        {
+            std::printf("  %zu slots\n", crossover);
+        }
+        else
+        {
+            std::printf("  none\n");
+        }
+    }
+
+    return 0;
+}
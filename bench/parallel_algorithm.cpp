@@ -0,0 +1,106 @@
+//
+// parallel_algorithm.cpp
+// Passageways
+//
+// Scaling of the thread_pool overloads in obj_parallel_algorithm.h from
+// one thread to the whole machine, against the serial obj_algorithm.h
+// versions. A pool of n - 1 workers runs n threads, the caller included.
+//
+//     g++ -std=c++11 -O2 -I.. -pthread parallel_algorithm.cpp -o parallel_algorithm
+//     ./parallel_algorithm [elements]
+//
+
+#include "bench.h"
+
+#include <obj_algorithm.h>
+#include <obj_parallel_algorithm.h>
+
+#include <cmath>
+#include <cstdlib>
+#include <thread>
+#include <vector>
+
+namespace
+{
+    double work(double x)
+    {
+        return std::sqrt(x) * std::sin(x) + std::cos(x);
+    }
+
+    bool keep_value(double x)
+    {
+        return work(x) > 0;
+    }
+
+    void report(const char* name, std::size_t threads, double serial, double ns)
+    {
+        std::printf("%-10s %3zu threads %9.2f ms  speedup %5.2f\n",
+                    name, threads, ns / 1e6, serial / ns);
+    }
+}
+
+int main(int argc, char** argv)
+{
+    std::size_t count = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 4000000;
+    std::size_t runs = 5;
+
+    std::vector<double> source(count);
+
+    for (std::size_t i = 0; i < count; ++i)
+    {
+        source[i] = static_cast<double>(i % 1000) + 0.5;
+    }
+
+    // The only match is the last element, so find_if scans everything.
+    double target = -1;
+    source.back() = target;
+
+    double serialTransform = bench::best_ns(runs, [&]()
+    {
+        bench::keep(obj::transform<std::vector<double>>(source, work));
+    });
+
+    double serialCopyIf = bench::best_ns(runs, [&]()
+    {
+        bench::keep(obj::copy_if(source, keep_value));
+    });
+
+    double serialFind = bench::best_ns(runs, [&]()
+    {
+        bench::keep(std::find_if(source.begin(), source.end(),
+                                 [target](double x) { return work(x) == work(target); }));
+    });
+
+    std::printf("%zu elements, serial: transform %.2f ms, copy_if %.2f ms, find_if %.2f ms\n",
+                count, serialTransform / 1e6, serialCopyIf / 1e6, serialFind / 1e6);
+
+    std::size_t hardware = std::max<std::size_t>(std::thread::hardware_concurrency(), 1);
+
+    for (std::size_t threads = 1; ; threads = std::min(threads * 2, hardware))
+    {
+        obj::thread_pool pool(threads - 1);
+
+        report("transform", threads, serialTransform, bench::best_ns(runs, [&]()
+        {
+            bench::keep(obj::transform<std::vector<double>>(pool, source, work));
+        }));
+
+        report("copy_if", threads, serialCopyIf, bench::best_ns(runs, [&]()
+        {
+            bench::keep(obj::copy_if(pool, source, keep_value));
+        }));
+
+        report("find_if", threads, serialFind, bench::best_ns(runs, [&]()
+        {
+            bench::keep(obj::find_if(pool, source,
+                                     [target](double x) { return work(x) == work(target); }));
+        }));
+
+        if (threads == hardware)
+        {
+            break;
+        }
+    }
+
+    return 0;
+}
@@ -9,7 +9,17 @@
 #ifndef __OBJ_ALGORITHM_H__
 #define __OBJ_ALGORITHM_H__
 
+#include <obj_flat_set.h>
+#include <obj_simd.h>
+#include <obj_views.h>
+
 #include <algorithm>
+#include <array>
+#include <functional>
+#include <iterator>
+#include <set>
+#include <type_traits>
+#include <vector>
 
 #include <assert.h>
 
@@ -32,34 +42,814 @@ namespace obj
         return result;
     };
     
+    // Set operations into a caller-supplied container, which is cleared and,
+    // where possible, reserved once. Reusing the same output across calls
+    // keeps its capacity, so steady-state calls do not allocate.
+    
+    namespace details
+    {
+        // Containers whose elements are contiguous, which the kernels in
+        // obj_simd.h can work on directly, and whether they are sorted and
+        // free of duplicates as the intersection kernel needs. A sorted
+        // vector may hold duplicates, which the merge algorithms keep
+        // track of, so only flat_set qualifies.
+        
+        template<class C>
+        struct contiguous
+        {
+            static const bool value = false;
+            static const bool sorted = false;
+            using value_type = void;
+        };
+        
+        template<class T, class A>
+        struct contiguous<std::vector<T, A>>
+        {
+            static const bool value = true;
+            static const bool sorted = false;
+            using value_type = T;
+        };
+        
+        template<class T, std::size_t N>
+        struct contiguous<std::array<T, N>>
+        {
+            static const bool value = true;
+            static const bool sorted = false;
+            using value_type = T;
+        };
+        
+        template<class T, class A>
+        struct contiguous<flat_set<T, std::less<T>, A>>
+        {
+            static const bool value = true;
+            static const bool sorted = true;
+            using value_type = T;
+        };
+        
+        template<class C, class T>
+        struct is_vector_of : std::false_type
+        {
+        };
+        
+        template<class T, class A>
+        struct is_vector_of<std::vector<T, A>, T> : std::true_type
+        {
+        };
+        
+        template<class T>
+        struct always_void
+        {
+            using type = void;
+        };
+        
+        template<class C, class = void>
+        struct is_unordered : std::false_type
+        {
+        };
+        
+        template<class C>
+        struct is_unordered<C, typename always_void<typename C::hasher>::type> : std::true_type
+        {
+        };
+        
+        template<class C1, class C2>
+        struct is_hashed :
+            std::integral_constant<bool, is_unordered<C1>::value || is_unordered<C2>::value>
+        {
+        };
+        
+        template<class C, class T>
+        struct simd_find :
+            std::integral_constant<bool,
+                contiguous<C>::value &&
+                std::is_same<typename contiguous<C>::value_type, T>::value &&
+                simd::is_searchable<T>::value>
+        {
+        };
+        
+        template<class C1, class C2, class C3>
+        struct simd_intersection :
+            std::integral_constant<bool,
+                contiguous<C1>::sorted && contiguous<C2>::sorted &&
+                std::is_same<typename contiguous<C1>::value_type,
+                             typename contiguous<C2>::value_type>::value &&
+                is_vector_of<C3, typename contiguous<C1>::value_type>::value &&
+                simd::is_intersectable<typename contiguous<C1>::value_type>::value>
+        {
+        };
+        
+        // How a binary set operation runs: merging sorted inputs, with the
+        // SIMD kernels, or probing a hash table when either input is an
+        // unordered container, whose iteration order is meaningless to the
+        // merge algorithms.
+        
+        struct merge_tag
+        {
+        };
+        
+        struct simd_tag
+        {
+        };
+        
+        struct hash_tag
+        {
+        };
+        
+        template<class C1, class C2, class C3>
+        struct intersection_strategy
+        {
+            using type =
+                typename std::conditional<is_hashed<C1, C2>::value, hash_tag,
+                    typename std::conditional<simd_intersection<C1, C2, C3>::value, simd_tag,
+                        merge_tag>::type>::type;
+        };
+        
+        template<class C1, class C2>
+        struct strategy
+        {
+            using type = typename std::conditional<is_hashed<C1, C2>::value, hash_tag, merge_tag>::type;
+        };
+        
+        // Membership through the container's own find() where it has one,
+        // otherwise by binary search of a sorted sequence.
+        template<class C, class T>
+        auto lookup(const C& c, const T& val, int) -> decltype(c.find(val) != c.end())
+        {
+            return c.find(val) != c.end();
+        }
+        
+        template<class C, class T>
+        bool lookup(const C& c, const T& val, long)
+        {
+            return std::binary_search(c.begin(), c.end(), val);
+        }
+        
+        // The order of a sorted container: its own comparator where it has
+        // one, otherwise operator<.
+        template<class C>
+        auto order_of(const C& c, int) -> decltype(c.value_comp())
+        {
+            return c.value_comp();
+        }
+        
+        template<class C>
+        std::less<typename C::value_type> order_of(const C&, long)
+        {
+            return std::less<typename C::value_type>();
+        }
+        
+        template<class C1, class C2, class C3>
+        void probe_into(const C1& walked, const C2& probed, C3& out, bool keepFound)
+        {
+            auto appendOut = appender(out, 0);
+            
+            for (const auto& val : walked)
+            {
+                if (lookup(probed, val, 0) == keepFound)
+                {
+                    *appendOut++ = val;
+                }
+            }
+        }
+        
+        template<class C1, class C2, class C3>
+        void set_intersection_into(const C1& a, const C2& b, C3& out, merge_tag)
+        {
+            out.clear();
+            reserve(out, std::min<std::size_t>(a.size(), b.size()), 0);
+            
+            std::set_intersection(a.begin(), a.end(), b.begin(), b.end(), appender(out, 0),
+                                  order_of(a, 0));
+        }
+        
+        template<class C1, class C2, class C3>
+        void set_intersection_into(const C1& a, const C2& b, C3& out, simd_tag)
+        {
+            out.resize(std::min(a.size(), b.size()) + simd::intersect_padding);
+            out.resize(simd::intersect(a.data(), a.size(), b.data(), b.size(), out.data()));
+        }
+        
+        // Walks the sorted side if there is one, so sorted output stays
+        // sorted, and otherwise the smaller side, probing the other.
+        template<class C1, class C2, class C3>
+        void set_intersection_into(const C1& a, const C2& b, C3& out, hash_tag)
+        {
+            out.clear();
+            reserve(out, std::min<std::size_t>(a.size(), b.size()), 0);
+            
+            if (is_unordered<C1>::value && (!is_unordered<C2>::value || b.size() < a.size()))
+            {
+                probe_into(b, a, out, true);
+            }
+            else
+            {
+                probe_into(a, b, out, true);
+            }
+        }
+        
+        template<class C1, class C2, class C3>
+        void set_difference_into(const C1& a, const C2& b, C3& out, merge_tag)
+        {
+            out.clear();
+            reserve(out, a.size(), 0);
+            
+            std::set_difference(a.begin(), a.end(), b.begin(), b.end(), appender(out, 0),
+                                order_of(a, 0));
+        }
+        
+        template<class C1, class C2, class C3>
+        void set_difference_into(const C1& a, const C2& b, C3& out, hash_tag)
+        {
+            out.clear();
+            reserve(out, a.size(), 0);
+            
+            probe_into(a, b, out, false);
+        }
+        
+        template<class C1, class C2, class C3>
+        void set_union_into(const C1& a, const C2& b, C3& out, merge_tag)
+        {
+            out.clear();
+            reserve(out, a.size() + b.size(), 0);
+            
+            std::set_union(a.begin(), a.end(), b.begin(), b.end(), appender(out, 0),
+                           order_of(a, 0));
+        }
+        
+        template<class C1, class C2, class C3>
+        void set_union_into(const C1& a, const C2& b, C3& out, hash_tag)
+        {
+            out.clear();
+            reserve(out, a.size() + b.size(), 0);
+            
+            std::copy(a.begin(), a.end(), appender(out, 0));
+            
+            probe_into(b, a, out, false);
+        }
+    }
+    
+    template<class C1, class C2, class C3>
+    void set_intersection_into(const C1& a, const C2& b, C3& out)
+    {
+        assert(static_cast<const void*>(&out) != &a && static_cast<const void*>(&out) != &b);
+        
+        details::set_intersection_into(a, b, out,
+            typename details::intersection_strategy<C1, C2, C3>::type());
+    }
+    
+    template<class C1, class C2, class C3>
+    void set_difference_into(const C1& a, const C2& b, C3& out)
+    {
+        assert(static_cast<const void*>(&out) != &a && static_cast<const void*>(&out) != &b);
+        
+        details::set_difference_into(a, b, out, typename details::strategy<C1, C2>::type());
+    }
+    
+    template<class C1, class C2, class C3>
+    void set_union_into(const C1& a, const C2& b, C3& out)
+    {
+        assert(static_cast<const void*>(&out) != &a && static_cast<const void*>(&out) != &b);
+        
+        details::set_union_into(a, b, out, typename details::strategy<C1, C2>::type());
+    }
+    
     template<class C>
     C
     set_intersection(const C& a, const C& b)
     {
-        using InputIterator = decltype(a.begin());
-        using OutputIterator = std::insert_iterator<C>;
+        C result;
+        
+        set_intersection_into(a, b, result);
         
-        return set_operation(a, b, std::set_intersection<InputIterator, InputIterator, OutputIterator>);
+        return result;
     }
     
     template<class C>
     C
     set_difference(const C& a, const C& b)
     {
-        using InputIterator = decltype(a.begin());
-        using OutputIterator = std::insert_iterator<C>;
+        C result;
+        
+        set_difference_into(a, b, result);
         
-        return set_operation(a, b, std::set_difference<InputIterator, InputIterator, OutputIterator>);
+        return result;
     }
     
     template<class C>
     C
     set_union(const C& a, const C& b)
     {
-        using InputIterator = decltype(a.begin());
-        using OutputIterator = std::insert_iterator<C>;
+        C result;
         
-        return set_operation(a, b, std::set_union<InputIterator, InputIterator, OutputIterator>);
+        set_union_into(a, b, result);
+        
+        return result;
+    }
+    
+    // In-place set operations, leaving the result in a. Vectors are
+    // compacted or merged within their own storage; node-based sets erase
+    // and insert in place. Sorted inputs are compared with a's comparator,
+    // or b's when a is a plain vector.
+    
+    namespace details
+    {
+        template<class T, class A, class C, class Compare>
+        void set_intersection_in_place(std::vector<T, A>& a, const C& b, Compare comp, merge_tag)
+        {
+            auto out = a.begin();
+            auto first1 = a.begin();
+            auto first2 = b.begin();
+            
+            while (first1 != a.end() && first2 != b.end())
+            {
+                if (comp(*first1, *first2))
+                {
+                    ++first1;
+                }
+                else if (comp(*first2, *first1))
+                {
+                    ++first2;
+                }
+                else
+                {
+                    if (out != first1)
+                    {
+                        *out = std::move(*first1);
+                    }
+                    
+                    ++out;
+                    ++first1;
+                    ++first2;
+                }
+            }
+            
+            a.erase(out, a.end());
+        }
+        
+        template<class T, class A, class C, class Compare>
+        void set_difference_in_place(std::vector<T, A>& a, const C& b, Compare comp, merge_tag)
+        {
+            auto out = a.begin();
+            auto first1 = a.begin();
+            auto first2 = b.begin();
+            
+            while (first1 != a.end())
+            {
+                while (first2 != b.end() && comp(*first2, *first1))
+                {
+                    ++first2;
+                }
+                
+                if (first2 == b.end() || comp(*first1, *first2))
+                {
+                    if (out != first1)
+                    {
+                        *out = std::move(*first1);
+                    }
+                    
+                    ++out;
+                }
+                else
+                {
+                    // Each element of b removes one equal element of a.
+                    ++first2;
+                }
+                
+                ++first1;
+            }
+            
+            a.erase(out, a.end());
+        }
+        
+        template<class T, class A, class C, class Compare>
+        void set_union_in_place(std::vector<T, A>& a, const C& b, Compare comp, merge_tag)
+        {
+            std::size_t extra = 0;
+            
+            auto first1 = a.begin();
+            
+            for (const auto& val : b)
+            {
+                while (first1 != a.end() && comp(*first1, val))
+                {
+                    ++first1;
+                }
+                
+                if (first1 == a.end() || comp(val, *first1))
+                {
+                    ++extra;
+                }
+                else
+                {
+                    // Paired with one equal element of a, which is kept.
+                    ++first1;
+                }
+            }
+            
+            if (extra == 0)
+            {
+                return;
+            }
+            
+            std::size_t size = a.size();
+            
+            a.resize(size + extra);
+            
+            // Merge from the back so nothing is overwritten before it is moved.
+            
+            auto out = a.rbegin();
+            auto last1 = a.rbegin() + extra;
+            auto last2 = b.rbegin();
+            
+            // Once out reaches last1 the rest of b is paired with the rest
+            // of a, which is already in place.
+            
+            while (out != last1)
+            {
+                if (last1 != a.rend() && !comp(*last1, *last2))
+                {
+                    if (!comp(*last2, *last1))
+                    {
+                        ++last2;
+                    }
+                    
+                    *out++ = std::move(*last1++);
+                }
+                else
+                {
+                    *out++ = *last2++;
+                }
+            }
+        }
+        
+        template<class T, class A, class C, class Compare>
+        void set_intersection_in_place(std::vector<T, A>& a, const C& b, Compare, hash_tag)
+        {
+            a.erase(std::remove_if(a.begin(), a.end(),
+            [&b](const T& val)
+            {
+                return !lookup(b, val, 0);
+            }), a.end());
+        }
+        
+        template<class T, class A, class C, class Compare>
+        void set_difference_in_place(std::vector<T, A>& a, const C& b, Compare, hash_tag)
+        {
+            a.erase(std::remove_if(a.begin(), a.end(),
+            [&b](const T& val)
+            {
+                return lookup(b, val, 0);
+            }), a.end());
+        }
+        
+        // The values missing from a arrive in hash order; they are sorted on
+        // the end and merged into place.
+        template<class T, class A, class C, class Compare>
+        void set_union_in_place(std::vector<T, A>& a, const C& b, Compare comp, hash_tag)
+        {
+            std::size_t size = a.size();
+            
+            for (const auto& val : b)
+            {
+                if (!std::binary_search(a.begin(), a.begin() + size, val, comp))
+                {
+                    a.push_back(val);
+                }
+            }
+            
+            std::sort(a.begin() + size, a.end(), comp);
+            std::inplace_merge(a.begin(), a.begin() + size, a.end(), comp);
+        }
+        
+        template<class C1, class C2, class Compare>
+        void set_intersection_in_place(C1& a, const C2& b, Compare comp, merge_tag)
+        {
+            auto first2 = b.begin();
+            
+            for (auto it = a.begin(); it != a.end(); )
+            {
+                while (first2 != b.end() && comp(*first2, *it))
+                {
+                    ++first2;
+                }
+                
+                if (first2 == b.end() || comp(*it, *first2))
+                {
+                    it = a.erase(it);
+                }
+                else
+                {
+                    ++it;
+                    ++first2;
+                }
+            }
+        }
+        
+        template<class C1, class C2, class Compare>
+        void set_difference_in_place(C1& a, const C2& b, Compare comp, merge_tag)
+        {
+            auto first2 = b.begin();
+            
+            for (auto it = a.begin(); it != a.end(); )
+            {
+                while (first2 != b.end() && comp(*first2, *it))
+                {
+                    ++first2;
+                }
+                
+                if (first2 != b.end() && !comp(*it, *first2))
+                {
+                    it = a.erase(it);
+                }
+                else
+                {
+                    ++it;
+                }
+            }
+        }
+        
+        template<class C1, class C2, class Compare>
+        void set_intersection_in_place(C1& a, const C2& b, Compare, hash_tag)
+        {
+            for (auto it = a.begin(); it != a.end(); )
+            {
+                it = lookup(b, *it, 0) ? std::next(it) : a.erase(it);
+            }
+        }
+        
+        template<class C1, class C2, class Compare>
+        void set_difference_in_place(C1& a, const C2& b, Compare, hash_tag)
+        {
+            for (auto it = a.begin(); it != a.end(); )
+            {
+                it = lookup(b, *it, 0) ? a.erase(it) : std::next(it);
+            }
+        }
+    }
+    
+    template<class T, class A, class C>
+    void set_intersection_in_place(std::vector<T, A>& a, const C& b)
+    {
+        details::set_intersection_in_place(a, b, details::order_of(b, 0),
+            typename details::strategy<std::vector<T, A>, C>::type());
+    }
+    
+    template<class T, class A, class C>
+    void set_difference_in_place(std::vector<T, A>& a, const C& b)
+    {
+        details::set_difference_in_place(a, b, details::order_of(b, 0),
+            typename details::strategy<std::vector<T, A>, C>::type());
+    }
+    
+    template<class T, class A, class C>
+    void set_union_in_place(std::vector<T, A>& a, const C& b)
+    {
+        details::set_union_in_place(a, b, details::order_of(b, 0),
+            typename details::strategy<std::vector<T, A>, C>::type());
+    }
+    
+    template<class T, class Compare, class A, class C>
+    void set_intersection_in_place(flat_set<T, Compare, A>& a, const C& b)
+    {
+        auto values = a.extract();
+        details::set_intersection_in_place(values, b, a.value_comp(),
+            typename details::strategy<flat_set<T, Compare, A>, C>::type());
+        a.adopt_sorted(std::move(values));
+    }
+    
+    template<class T, class Compare, class A, class C>
+    void set_difference_in_place(flat_set<T, Compare, A>& a, const C& b)
+    {
+        auto values = a.extract();
+        details::set_difference_in_place(values, b, a.value_comp(),
+            typename details::strategy<flat_set<T, Compare, A>, C>::type());
+        a.adopt_sorted(std::move(values));
+    }
+    
+    template<class T, class Compare, class A, class C>
+    void set_union_in_place(flat_set<T, Compare, A>& a, const C& b)
+    {
+        auto values = a.extract();
+        details::set_union_in_place(values, b, a.value_comp(),
+            typename details::strategy<flat_set<T, Compare, A>, C>::type());
+        a.adopt_sorted(std::move(values));
+    }
+    
+    template<class C1, class C2>
+    void set_intersection_in_place(C1& a, const C2& b)
+    {
+        details::set_intersection_in_place(a, b, details::order_of(a, 0),
+            typename details::strategy<C1, C2>::type());
+    }
+    
+    template<class C1, class C2>
+    void set_difference_in_place(C1& a, const C2& b)
+    {
+        details::set_difference_in_place(a, b, details::order_of(a, 0),
+            typename details::strategy<C1, C2>::type());
+    }
+    
+    template<class C1, class C2>
+    void set_union_in_place(C1& a, const C2& b)
+    {
+        a.insert(b.begin(), b.end());
+    }
+    
+    // N-ary set operations over a range of sorted or unordered containers.
+    
+    namespace details
+    {
+        // Intersects a small set with a much larger one by looking each
+        // value up instead of walking the larger one.
+        template<class C>
+        void intersect_probe(const C& small, const C& large, C& out,
+                             std::random_access_iterator_tag)
+        {
+            out.clear();
+            
+            auto appendOut = appender(out, 0);
+            auto comp = order_of(large, 0);
+            auto first = large.begin();
+            
+            for (const auto& val : small)
+            {
+                first = simd::gallop(first, large.end(), val, comp);
+                
+                if (first == large.end())
+                {
+                    break;
+                }
+                
+                if (!comp(val, *first))
+                {
+                    *appendOut++ = val;
+                }
+            }
+        }
+        
+        template<class C>
+        void intersect_probe(const C& small, const C& large, C& out,
+                             std::forward_iterator_tag)
+        {
+            out.clear();
+            
+            probe_into(small, large, out, true);
+        }
+        
+        template<class C, class R>
+        C set_union(const R& sets, std::true_type)
+        {
+            std::size_t largest = 0;
+            
+            for (const auto& set : sets)
+            {
+                largest = std::max<std::size_t>(largest, set.size());
+            }
+            
+            C result;
+            result.reserve(largest);
+            
+            for (const auto& set : sets)
+            {
+                result.insert(set.begin(), set.end());
+            }
+            
+            return result;
+        }
+        
+        // Merges all the containers at once through a heap of their cursors,
+        // so each value is handled once whatever the number of inputs.
+        template<class C, class R>
+        C set_union(const R& sets, std::false_type)
+        {
+            using iterator = typename C::const_iterator;
+            using cursor = std::pair<iterator, iterator>;
+            
+            auto comp = order_of(C(), 0);
+            auto greater =
+            [&comp](const cursor& lhs, const cursor& rhs)
+            {
+                return comp(*rhs.first, *lhs.first);
+            };
+            
+            std::vector<cursor> heap;
+            std::size_t largest = 0;
+            
+            for (const auto& set : sets)
+            {
+                if (!set.empty())
+                {
+                    heap.push_back(cursor(set.begin(), set.end()));
+                    largest = std::max<std::size_t>(largest, set.size());
+                }
+            }
+            
+            std::make_heap(heap.begin(), heap.end(), greater);
+            
+            C result;
+            reserve(result, largest, 0);
+            
+            auto out = appender(result, 0);
+            iterator last;
+            bool any = false;
+            
+            while (!heap.empty())
+            {
+                std::pop_heap(heap.begin(), heap.end(), greater);
+                
+                cursor& top = heap.back();
+                
+                if (!any || comp(*last, *top.first))
+                {
+                    *out++ = *top.first;
+                    last = top.first;
+                    any = true;
+                }
+                
+                if (++top.first == top.second)
+                {
+                    heap.pop_back();
+                }
+                else
+                {
+                    std::push_heap(heap.begin(), heap.end(), greater);
+                }
+            }
+            
+            return result;
+        }
+    }
+    
+    // Unordered containers are inserted into one another; sorted ones
+    // are merged in a single pass.
+    template<class R>
+    typename R::value_type set_union(const R& sets)
+    {
+        using C = typename R::value_type;
+        
+        return details::set_union<C>(sets, details::is_unordered<C>());
+    }
+    
+    // Intersects from the smallest container up, so the running result only
+    // shrinks; stops as soon as it is empty. Containers much larger than
+    // the running result are probed rather than walked.
+    template<class R>
+    typename R::value_type set_intersection(const R& sets)
+    {
+        using C = typename R::value_type;
+        using category = typename std::iterator_traits<typename C::const_iterator>::iterator_category;
+        
+        std::vector<const C*> bySize;
+        
+        for (const auto& set : sets)
+        {
+            bySize.push_back(&set);
+        }
+        
+        if (bySize.empty())
+        {
+            return C();
+        }
+        
+        std::sort(bySize.begin(), bySize.end(),
+        [](const C* lhs, const C* rhs)
+        {
+            return lhs->size() < rhs->size();
+        });
+        
+        if (bySize.size() == 1)
+        {
+            return *bySize[0];
+        }
+        
+        C result;
+        C next;
+        
+        const C* current = bySize[0];
+        
+        for (std::size_t i = 1; i < bySize.size() && !current->empty(); ++i)
+        {
+            const C& other = *bySize[i];
+            
+            if (other.size() / current->size() >= 32)
+            {
+                details::intersect_probe(*current, other, next, category());
+            }
+            else
+            {
+                set_intersection_into(*current, other, next);
+            }
+            
+            result.swap(next);
+            current = &result;
+        }
+        
+        if (current != &result)
+        {
+            return C();
+        }
+        
+        return result;
     }
 
     template<class C>
@@ -86,10 +876,25 @@ namespace obj
         return result;
     }
 
+    namespace details
+    {
+        template <class C, class T>
+        typename C::const_iterator find(const C& c, const T& val, std::false_type)
+        {
+            return std::find(c.begin(), c.end(), val);
+        }
+        
+        template <class C, class T>
+        typename C::const_iterator find(const C& c, const T& val, std::true_type)
+        {
+            return c.begin() + simd::find(c.data(), c.size(), val);
+        }
+    }
+    
     template <class C, class T>
     typename C::const_iterator find(const C& c, const T& val)
     {
-        return std::find(c.begin(), c.end(), val);
+        return details::find(c, val, details::simd_find<C, T>());
     }
     
     template <class C, class T>
@@ -119,19 +924,12 @@ namespace obj
     template<class C1, class C2, class Fn>
     C1 transform(const C2& source, Fn fn);
     
+    // Prefer iterating views::values(source) when the set itself is not
+    // needed.
     template<class M>
     std::set<typename M::mapped_type> range(const M& source)
     {
-        using result_type = std::set<typename M::mapped_type>;
-        result_type result;
-        
-        auto get_val =
-        [](const typename M::value_type& key_value) -> typename M::mapped_type
-        {
-            return key_value.second;
-        };
-        
-        return transform<result_type>(source, get_val);
+        return views::to<std::set<typename M::mapped_type>>(views::values(source));
     };
     
     template<class C, class Pred>
@@ -144,24 +942,35 @@ namespace obj
     template<class C1, class C2, class Fn>
     C1 transform(const C2& source, Fn fn)
     {
-        C1 result;
-        std::insert_iterator<C1> insert(result, result.begin());
-        
-        std::transform(source.begin(), source.end(), insert, fn);
-        
-        return result;
+        return views::to<C1>(views::transform(source, fn));
     }
 
     template<class C1, class C2, class Fn>
     C1 transform_and_copy(const C2& source, Fn fn)
     {
-        return copy(transform<C1>(source, fn));
+        return views::to<C1>(views::transform(source, fn));
     }
 
+    // Transforms and filters in one pass, without an intermediate C1, and
+    // calls fn once per element.
     template<class C1, class C2, class Fn, class Pred>
     C1 transform_and_copy_if(const C2& source, Fn fn, Pred pred)
     {
-        return copy_if(transform<C1>(source, fn), pred);
+        C1 result;
+        
+        auto out = details::appender(result, 0);
+        
+        for (const auto& val : source)
+        {
+            auto transformed = fn(val);
+            
+            if (pred(transformed))
+            {
+                *out++ = std::move(transformed);
+            }
+        }
+        
+        return result;
     }
     
 #ifndef DEBUG
@@ -29,22 +29,29 @@
 
 #include <obj_property.h>
 
+#include <vector>
+
 namespace obj
 {
-    template<class T>
-    obj::connection connect(const obj::property<T>& source, obj::property<T>& dest)
+    // Any property types will do: property, lazy_property, bound and
+    // mapped properties...
+    
+    template<class P1, class P2, class T = typename property_value<P1>::type>
+    auto connect(P1& source, P2& dest)
+        -> decltype(dest = source(), source.connect(std::function<void(const T&)>()))
     {
         auto onSourceChanged =
-        [=](const T& newVal, const T& oldVal)
+        [&dest](const T& newVal)
         {
             dest = newVal;
         };
         
-        return source.connect(onSourceChanged);
+        return source.connect(std::function<void(const T&)>(onSourceChanged));
     };
 
-    template<class S, class D>
-    obj::connection connect(obj::property<S>& source, obj::property<D>& dest, std::function<D(const S&)> converter)
+    template<class P1, class P2, class Fn, class S = typename property_value<P1>::type>
+    auto connect(P1& source, P2& dest, Fn converter)
+        -> decltype(dest = converter(source()), source.connect(std::function<void(const S&)>()))
     {
         auto onSourceChanged =
         [=, &dest](const S& newVal)
@@ -52,8 +59,133 @@ namespace obj
             dest = converter(newVal);
         };
         
-        return source.connect(onSourceChanged);
+        return source.connect(std::function<void(const S&)>(onSourceChanged));
+    };
+    
+    // two-way bindings
+    //
+    // Each side updates the other when it changes. A flag shared by both
+    // directions is raised while an update is being forwarded, so the echo
+    // from the other side is dropped before it reaches a converter or
+    // compare. The binding starts by copying a into b.
+    
+    class binding
+    {
+    public:
+        binding() :
+            _connections()
+        {
+        }
+        
+        void add(const connection& cnxn)
+        {
+            _connections.push_back(cnxn);
+        }
+        
+        bool connected() const
+        {
+            for (const auto& cnxn : _connections)
+            {
+                if (cnxn.valid())
+                {
+                    return true;
+                }
+            }
+            
+            return false;
+        }
+        
+        void disconnect() const
+        {
+            for (const auto& cnxn : _connections)
+            {
+                cnxn.disconnect();
+            }
+        }
+        
+        void block() const
+        {
+            for (const auto& cnxn : _connections)
+            {
+                cnxn.block();
+            }
+        }
+        
+        void unblock() const
+        {
+            for (const auto& cnxn : _connections)
+            {
+                cnxn.unblock();
+            }
+        }
+        
+    private:
+        std::vector<connection> _connections;
+    };
+    
+    class binding_guard
+    {
+    public:
+        binding_guard(bool& updating) :
+            _updating(updating)
+        {
+            _updating = true;
+        }
+        
+        ~binding_guard()
+        {
+            _updating = false;
+        }
+        
+    private:
+        binding_guard(const binding_guard&);
+        
+        bool& _updating;
     };
+    
+    template<class P1, class P2, class To, class From,
+             class S = typename property_value<P1>::type, class D = typename property_value<P2>::type>
+    obj::binding bind(P1& a, P2& b, To to, From from)
+    {
+        auto updating = std::make_shared<bool>(false);
+        
+        auto onAChanged =
+        [updating, &b, to](const S& newVal)
+        {
+            if (!*updating)
+            {
+                binding_guard guard(*updating);
+                b = to(newVal);
+            }
+        };
+        
+        auto onBChanged =
+        [updating, &a, from](const D& newVal)
+        {
+            if (!*updating)
+            {
+                binding_guard guard(*updating);
+                a = from(newVal);
+            }
+        };
+        
+        onAChanged(a());
+        
+        obj::binding result;
+        
+        result.add(a.connect(std::function<void(const S&)>(onAChanged)));
+        result.add(b.connect(std::function<void(const D&)>(onBChanged)));
+        
+        return result;
+    }
+    
+    template<class P1, class P2, class T = typename property_value<P1>::type>
+    obj::binding bind(P1& a, P2& b)
+    {
+        return bind(a, b,
+                    [](const T& val) -> const T& { return val; },
+                    [](const T& val) -> const T& { return val; });
+    }
 }
 
 #endif
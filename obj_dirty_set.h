@@ -0,0 +1,161 @@
+//
+// obj_dirty_set.h
+// Passageways
+//
+// Copyright (c) 2014 Vincent Tourangeau.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+#ifndef __OBJ_DIRTY_SET_H__
+#define __OBJ_DIRTY_SET_H__
+
+#include <assert.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace obj
+{
+    // A set of indices in [0, size) kept as a bitmap plus the list of set
+    // indices in insertion order, so inserts are O(1) and clearing or
+    // draining costs O(number of indices set), not O(size).
+
+    class dirty_set
+    {
+    public:
+        dirty_set(std::size_t size = 0) :
+            _bits((size + 63) / 64),
+            _draining(),
+            _indices(),
+            _size(size)
+        {
+        }
+
+        std::size_t capacity() const
+        {
+            return _size;
+        }
+
+        void resize(std::size_t size)
+        {
+            if (size < _size)
+            {
+                clear();
+            }
+
+            _bits.resize((size + 63) / 64);
+            _size = size;
+        }
+
+        bool insert(std::size_t idx)
+        {
+            assert(idx < _size);
+
+            std::uint64_t& word = _bits[idx / 64];
+            std::uint64_t mask = std::uint64_t(1) << (idx % 64);
+
+            if (word & mask)
+            {
+                return false;
+            }
+
+            word |= mask;
+            _indices.push_back(idx);
+
+            return true;
+        }
+
+        void insert(std::size_t first, std::size_t last)
+        {
+            for (std::size_t idx = first; idx < last; ++idx)
+            {
+                insert(idx);
+            }
+        }
+
+        bool contains(std::size_t idx) const
+        {
+            assert(idx < _size);
+
+            return (_bits[idx / 64] >> (idx % 64)) & 1;
+        }
+
+        bool empty() const
+        {
+            return _indices.empty();
+        }
+
+        std::size_t size() const
+        {
+            return _indices.size();
+        }
+
+        const std::vector<std::size_t>& indices() const
+        {
+            return _indices;
+        }
+
+        void clear()
+        {
+            for (auto idx : _indices)
+            {
+                _bits[idx / 64] = 0;
+            }
+
+            _indices.clear();
+        }
+
+        // Empties the set, then calls fn with the indices it held. Indices
+        // inserted by fn are kept for the next drain.
+        template<class Fn>
+        void drain(Fn fn)
+        {
+            std::vector<std::size_t> draining;
+
+            draining.swap(_draining);
+            clear_into(draining);
+
+            fn(static_cast<const std::vector<std::size_t>&>(draining));
+
+            draining.clear();
+            _draining.swap(draining);
+        }
+
+    private:
+        void clear_into(std::vector<std::size_t>& out)
+        {
+            for (auto idx : _indices)
+            {
+                _bits[idx / 64] = 0;
+            }
+
+            out.swap(_indices);
+            _indices.clear();
+        }
+
+        std::vector<std::uint64_t>  _bits;
+        std::vector<std::size_t>    _draining;
+        std::vector<std::size_t>    _indices;
+        std::size_t                 _size;
+    };
+}
+
+#endif
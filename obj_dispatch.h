@@ -0,0 +1,330 @@
+//
+// obj_dispatch.h
+// Passageways
+//
+// Copyright (c) 2014 Vincent Tourangeau.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+#ifndef __OBJ_DISPATCH_H__
+#define __OBJ_DISPATCH_H__
+
+#include <obj_function.h>
+
+#include <assert.h>
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace obj
+{
+    // Commands are named by a 64-bit FNV-1a hash of their name, computed at
+    // compile time for literals:
+    //
+    //     constexpr obj::command_id save = obj::command_hash("save");
+    //
+    //     obj::command_dispatcher commands;
+    //     commands.add(save, std::function<bool(std::string)>(saveTo));
+    //     commands.call<bool, std::string>(save, "out.txt");
+    //
+    // Names arriving at run time hash to the same ids through the
+    // std::string overload.
+
+    using command_id = std::uint64_t;
+
+    namespace details
+    {
+        constexpr std::uint64_t fnv1a(const char* str, std::uint64_t hash)
+        {
+            return *str ? fnv1a(str + 1, (hash ^ static_cast<unsigned char>(*str)) * 1099511628211ull) :
+                hash;
+        }
+
+        constexpr std::uint64_t fnv1a_basis = 14695981039346656037ull;
+    }
+
+    constexpr command_id command_hash(const char* name)
+    {
+        return details::fnv1a(name, details::fnv1a_basis);
+    }
+
+    inline command_id command_hash(const std::string& name)
+    {
+        std::uint64_t hash = details::fnv1a_basis;
+
+        for (char c : name)
+        {
+            hash = (hash ^ static_cast<unsigned char>(c)) * 1099511628211ull;
+        }
+
+        return hash;
+    }
+
+    namespace details
+    {
+        class command_table_base
+        {
+        public:
+            virtual ~command_table_base() {}
+        };
+
+        // Open addressing with linear probing over a power of two capacity
+        // kept at most half full. The ids are already well mixed hashes, so
+        // their low bits pick the slot directly; id 0 marks an empty slot.
+        template<class R, class... A>
+        class command_table : public command_table_base
+        {
+        public:
+            using wrapper = typed_function_wrapper<R, A...>;
+
+            command_table() :
+                _count(0),
+                _slots(16)
+            {
+            }
+
+            void insert(command_id id, const wrapper& fn)
+            {
+                if ((_count + 1) * 2 > _slots.size())
+                {
+                    grow();
+                }
+
+                slot& s = probe(id);
+
+                if (s._id == 0)
+                {
+                    ++_count;
+                }
+
+                s._id = id;
+                s._fn = fn;
+            }
+
+            const wrapper* find(command_id id) const
+            {
+                std::size_t mask = _slots.size() - 1;
+
+                for (std::size_t i = id & mask; ; i = (i + 1) & mask)
+                {
+                    const slot& s = _slots[i];
+
+                    if (s._id == id)
+                    {
+                        return &s._fn;
+                    }
+
+                    if (s._id == 0)
+                    {
+                        return nullptr;
+                    }
+                }
+            }
+
+        private:
+            struct slot
+            {
+                slot() :
+                    _fn(),
+                    _id(0)
+                {
+                }
+
+                wrapper     _fn;
+                command_id  _id;
+            };
+
+            slot& probe(command_id id)
+            {
+                std::size_t mask = _slots.size() - 1;
+                std::size_t i = id & mask;
+
+                while (_slots[i]._id != 0 && _slots[i]._id != id)
+                {
+                    i = (i + 1) & mask;
+                }
+
+                return _slots[i];
+            }
+
+            void grow()
+            {
+                std::vector<slot> old(_slots.size() * 2);
+                old.swap(_slots);
+
+                for (auto& s : old)
+                {
+                    if (s._id != 0)
+                    {
+                        probe(s._id) = std::move(s);
+                    }
+                }
+            }
+
+            std::size_t         _count;
+            std::vector<slot>   _slots;
+        };
+
+        inline std::size_t next_signature()
+        {
+            static std::atomic<std::size_t> next(0);
+
+            return next++;
+        }
+
+        // A process-wide index per call signature, assigned on first use.
+        template<class R, class... A>
+        std::size_t signature_index()
+        {
+            static const std::size_t idx = next_signature();
+
+            return idx;
+        }
+    }
+
+    // A registry of commands of any signature, kept in one flat table per
+    // signature. The signature is checked when a command is added: an id can
+    // only be registered under one signature, and an obj::function is only
+    // accepted if it has the signature it is added under. A call then looks
+    // its id up in the table of the signature it was made with, with no type
+    // check of its own.
+
+    class command_dispatcher
+    {
+    public:
+        command_dispatcher() :
+            _signatures(),
+            _tables()
+        {
+        }
+
+        // Returns false if id is already registered with another signature,
+        // which includes two names hashing to the same id.
+        template<class R, class... A>
+        bool add(command_id id, std::function<R(A...)> fn)
+        {
+            return add(id, typed_function_wrapper<R, A...>(fn));
+        }
+
+        // Returns false if fn does not have the signature R(A...), or if id
+        // is already registered with another signature.
+        template<class R, class... A>
+        bool add(command_id id, const function& fn)
+        {
+            const typed_function_wrapper<R, A...>* typed = fn.as<R, A...>();
+
+            return typed && add(id, *typed);
+        }
+
+        template<class R, class... A>
+        bool add(command_id id, const typed_function_wrapper<R, A...>& fn)
+        {
+            assert(id != 0);
+
+            std::size_t signature = details::signature_index<R, A...>();
+
+            auto registered = _signatures.insert(std::make_pair(id, signature));
+
+            if (registered.first->second != signature)
+            {
+                return false;
+            }
+
+            table<R, A...>(true)->insert(id, fn);
+
+            return true;
+        }
+
+        // The command registered as id with the signature R(A...), or null.
+        // Callers dispatching the same command repeatedly can keep the
+        // result, which stays valid until the next add().
+        template<class R, class... A>
+        const typed_function_wrapper<R, A...>* find(command_id id) const
+        {
+            const details::command_table<R, A...>* commands = table<R, A...>();
+
+            return commands ? commands->find(id) : nullptr;
+        }
+
+        template<class R, class... A, class... P>
+        R call(command_id id, P&&... args) const
+        {
+            const typed_function_wrapper<R, A...>* fn = find<R, A...>(id);
+
+            assert(fn);
+
+            if (fn)
+            {
+                return (*fn)(std::forward<P>(args)...);
+            }
+            else
+            {
+                return R();
+            }
+        }
+
+        bool contains(command_id id) const
+        {
+            return _signatures.count(id) != 0;
+        }
+
+    private:
+        command_dispatcher(const command_dispatcher&);
+
+        template<class R, class... A>
+        const details::command_table<R, A...>* table() const
+        {
+            std::size_t signature = details::signature_index<R, A...>();
+
+            return signature < _tables.size() ?
+                static_cast<const details::command_table<R, A...>*>(_tables[signature].get()) :
+                nullptr;
+        }
+
+        template<class R, class... A>
+        details::command_table<R, A...>* table(bool)
+        {
+            std::size_t signature = details::signature_index<R, A...>();
+
+            if (signature >= _tables.size())
+            {
+                _tables.resize(signature + 1);
+            }
+
+            if (!_tables[signature])
+            {
+                _tables[signature].reset(new details::command_table<R, A...>());
+            }
+
+            return static_cast<details::command_table<R, A...>*>(_tables[signature].get());
+        }
+
+        std::unordered_map<command_id, std::size_t>                 _signatures;
+        std::vector<std::unique_ptr<details::command_table_base>>   _tables;
+    };
+}
+
+#endif
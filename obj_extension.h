@@ -29,6 +29,10 @@
 
 #include <obj_property.h>
 
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
 namespace obj
 {
     template<class T>
@@ -48,6 +52,324 @@ namespace obj
     protected:
         const_property<T> root;
     };
+    
+    // extension storage
+    //
+    // Extensions attached to objects through side tables instead of
+    // wrappers. Each extendable object gets a compact id; each extension
+    // type keeps its instances in a dense array indexed through a sparse
+    // id table, so lookups are O(1), extensions are created on first use,
+    // and all instances of one extension can be iterated contiguously.
+    //
+    // Ids and extension creation, removal and lookup are serialized by the
+    // registry's mutex, so objects can be created, extended and destroyed
+    // from any thread. Extensions are moved when others of their type are
+    // created or removed: a thread holding a reference from extend() or
+    // find(), or iterating a storage, while other threads do that must
+    // hold extension_registry::get().mutex() throughout, and look up
+    // through the *_locked functions, which expect it held. Extensions are
+    // constructed and destroyed under that mutex, so they must not create
+    // or destroy extendable objects themselves.
+    
+    using object_id = std::uint32_t;
+    
+    class extension_storage_base
+    {
+    public:
+        virtual ~extension_storage_base() {}
+        
+        // Called by the registry with its mutex held.
+        virtual void remove(object_id id) = 0;
+    };
+    
+    class extension_registry
+    {
+    public:
+        static extension_registry& get()
+        {
+            static extension_registry instance;
+            
+            return instance;
+        }
+        
+        object_id acquire()
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            
+            if (!_free.empty())
+            {
+                object_id id = _free.back();
+                _free.pop_back();
+                
+                return id;
+            }
+            
+            return _next++;
+        }
+        
+        void release(object_id id)
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            std::lock_guard<std::mutex> storagesLock(_storagesMutex);
+            
+            for (auto storage : _storages)
+            {
+                storage->remove(id);
+            }
+            
+            _free.push_back(id);
+        }
+        
+        // Takes only the storage list's own mutex, so a storage can be
+        // created on first use by a caller holding mutex().
+        void add_storage(extension_storage_base* storage)
+        {
+            std::lock_guard<std::mutex> lock(_storagesMutex);
+            
+            _storages.push_back(storage);
+        }
+        
+        std::mutex& mutex()
+        {
+            return _mutex;
+        }
+        
+    private:
+        extension_registry() :
+            _free(),
+            _mutex(),
+            _next(0),
+            _storages(),
+            _storagesMutex()
+        {
+        }
+        
+        extension_registry(const extension_registry&);
+        
+        std::vector<object_id>                  _free;
+        std::mutex                              _mutex;
+        object_id                               _next;
+        std::vector<extension_storage_base*>    _storages;
+        std::mutex                              _storagesMutex;
+    };
+    
+    class extendable
+    {
+    public:
+        extendable() :
+            _obj_id(extension_registry::get().acquire())
+        {
+        }
+        
+        extendable(const extendable&) :
+            _obj_id(extension_registry::get().acquire())
+        {
+        }
+        
+        virtual ~extendable()
+        {
+            extension_registry::get().release(_obj_id);
+        }
+        
+        extendable& operator=(const extendable&)
+        {
+            return *this;
+        }
+        
+        object_id obj_id() const
+        {
+            return _obj_id;
+        }
+        
+    private:
+        object_id _obj_id;
+    };
+    
+    template<class E>
+    class extension_storage : public extension_storage_base
+    {
+    public:
+        using iterator = typename std::vector<E>::iterator;
+        using const_iterator = typename std::vector<E>::const_iterator;
+        
+        static extension_storage<E>& get()
+        {
+            static extension_storage<E>* instance = create();
+            
+            return *instance;
+        }
+        
+        E* find(object_id id)
+        {
+            std::lock_guard<std::mutex> lock(extension_registry::get().mutex());
+            
+            return find_locked(id);
+        }
+        
+        const E* find(object_id id) const
+        {
+            std::lock_guard<std::mutex> lock(extension_registry::get().mutex());
+            
+            return find_locked(id);
+        }
+        
+        E* find_locked(object_id id)
+        {
+            std::uint32_t idx = index_of(id);
+            
+            return idx == npos ? nullptr : &_values[idx];
+        }
+        
+        const E* find_locked(object_id id) const
+        {
+            std::uint32_t idx = index_of(id);
+            
+            return idx == npos ? nullptr : &_values[idx];
+        }
+        
+        bool contains(object_id id) const
+        {
+            std::lock_guard<std::mutex> lock(extension_registry::get().mutex());
+            
+            return index_of(id) != npos;
+        }
+        
+        E& operator[](object_id id)
+        {
+            std::lock_guard<std::mutex> lock(extension_registry::get().mutex());
+            
+            return get_locked(id);
+        }
+        
+        E& get_locked(object_id id)
+        {
+            std::uint32_t idx = index_of(id);
+            
+            if (idx != npos)
+            {
+                return _values[idx];
+            }
+            
+            if (id >= _sparse.size())
+            {
+                _sparse.resize(id + 1, std::uint32_t(npos));
+            }
+            
+            _sparse[id] = static_cast<std::uint32_t>(_values.size());
+            _owners.push_back(id);
+            _values.emplace_back();
+            
+            return _values.back();
+        }
+        
+        void remove(object_id id)
+        {
+            std::uint32_t idx = index_of(id);
+            
+            if (idx == npos)
+            {
+                return;
+            }
+            
+            std::uint32_t last = static_cast<std::uint32_t>(_values.size() - 1);
+            
+            if (idx != last)
+            {
+                _values[idx] = std::move(_values[last]);
+                _owners[idx] = _owners[last];
+                _sparse[_owners[idx]] = idx;
+            }
+            
+            _values.pop_back();
+            _owners.pop_back();
+            _sparse[id] = npos;
+        }
+        
+        std::size_t size() const
+        {
+            return _values.size();
+        }
+        
+        iterator begin()
+        {
+            return _values.begin();
+        }
+        
+        iterator end()
+        {
+            return _values.end();
+        }
+        
+        const_iterator begin() const
+        {
+            return _values.begin();
+        }
+        
+        const_iterator end() const
+        {
+            return _values.end();
+        }
+        
+        // The owner of the extension at the same position in [begin, end).
+        const std::vector<object_id>& owners() const
+        {
+            return _owners;
+        }
+        
+    private:
+        static const std::uint32_t npos = UINT32_MAX;
+        
+        static extension_storage<E>* create()
+        {
+            extension_storage<E>* storage = new extension_storage<E>();
+            
+            extension_registry::get().add_storage(storage);
+            
+            return storage;
+        }
+        
+        extension_storage() :
+            _owners(),
+            _sparse(),
+            _values()
+        {
+        }
+        
+        extension_storage(const extension_storage&);
+        
+        std::uint32_t index_of(object_id id) const
+        {
+            return id < _sparse.size() ? _sparse[id] : npos;
+        }
+        
+        std::vector<object_id>      _owners;
+        std::vector<std::uint32_t>  _sparse;
+        std::vector<E>              _values;
+    };
+    
+    template<class E>
+    E& extend(const extendable& obj)
+    {
+        return extension_storage<E>::get()[obj.obj_id()];
+    }
+    
+    template<class E>
+    E& extend_locked(const extendable& obj)
+    {
+        return extension_storage<E>::get().get_locked(obj.obj_id());
+    }
+    
+    template<class E>
+    E* find_extension(const extendable& obj)
+    {
+        return extension_storage<E>::get().find(obj.obj_id());
+    }
+    
+    template<class E>
+    E* find_extension_locked(const extendable& obj)
+    {
+        return extension_storage<E>::get().find_locked(obj.obj_id());
+    }
 }
 
 
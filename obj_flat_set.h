@@ -0,0 +1,318 @@
+//
+// obj_flat_set.h
+// Passageways
+//
+// Copyright (c) 2015 Vincent Tourangeau.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+#ifndef __OBJ_FLAT_SET_H__
+#define __OBJ_FLAT_SET_H__
+
+#include <algorithm>
+#include <functional>
+#include <initializer_list>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include <assert.h>
+
+namespace obj
+{
+    // A set kept as a sorted vector of unique values. Lookups are binary
+    // searches over contiguous memory; inserts in the middle are O(n), so
+    // it suits sets that are built in order and then mostly read.
+
+    template<class T, class Compare = std::less<T>, class Allocator = std::allocator<T>>
+    class flat_set
+    {
+    public:
+        using container_type = std::vector<T, Allocator>;
+        using key_type = T;
+        using value_type = T;
+        using key_compare = Compare;
+        using value_compare = Compare;
+        using allocator_type = Allocator;
+        using size_type = typename container_type::size_type;
+        using difference_type = typename container_type::difference_type;
+        using reference = const T&;
+        using const_reference = const T&;
+        using iterator = typename container_type::const_iterator;
+        using const_iterator = typename container_type::const_iterator;
+        using reverse_iterator = typename container_type::const_reverse_iterator;
+        using const_reverse_iterator = typename container_type::const_reverse_iterator;
+
+        flat_set() :
+            _comp(),
+            _values()
+        {
+        }
+
+        explicit flat_set(const Compare& comp) :
+            _comp(comp),
+            _values()
+        {
+        }
+
+        template<class InputIterator>
+        flat_set(InputIterator first, InputIterator last,
+                 const Compare& comp = Compare()) :
+            _comp(comp),
+            _values(first, last)
+        {
+            normalize();
+        }
+
+        flat_set(std::initializer_list<T> values,
+                 const Compare& comp = Compare()) :
+            _comp(comp),
+            _values(values)
+        {
+            normalize();
+        }
+
+        const_iterator begin() const
+        {
+            return _values.begin();
+        }
+
+        const_iterator end() const
+        {
+            return _values.end();
+        }
+
+        const_reverse_iterator rbegin() const
+        {
+            return _values.rbegin();
+        }
+
+        const_reverse_iterator rend() const
+        {
+            return _values.rend();
+        }
+
+        const T* data() const
+        {
+            return _values.data();
+        }
+
+        bool empty() const
+        {
+            return _values.empty();
+        }
+
+        size_type size() const
+        {
+            return _values.size();
+        }
+
+        size_type capacity() const
+        {
+            return _values.capacity();
+        }
+
+        void reserve(size_type size)
+        {
+            _values.reserve(size);
+        }
+
+        void shrink_to_fit()
+        {
+            _values.shrink_to_fit();
+        }
+
+        void clear()
+        {
+            _values.clear();
+        }
+
+        key_compare key_comp() const
+        {
+            return _comp;
+        }
+
+        value_compare value_comp() const
+        {
+            return _comp;
+        }
+
+        std::pair<iterator, bool> insert(const T& val)
+        {
+            auto it = std::lower_bound(_values.begin(), _values.end(), val, _comp);
+
+            if (it != _values.end() && !_comp(val, *it))
+            {
+                return std::make_pair(iterator(it), false);
+            }
+
+            return std::make_pair(iterator(_values.insert(it, val)), true);
+        }
+
+        // Uses hint when val belongs right before it, which makes appending
+        // in order through std::insert_iterator O(1).
+        iterator insert(const_iterator hint, const T& val)
+        {
+            if ((hint == end() || _comp(val, *hint)) &&
+                (hint == begin() || _comp(*(hint - 1), val)))
+            {
+                return _values.insert(_values.begin() + (hint - begin()), val);
+            }
+
+            return insert(val).first;
+        }
+
+        template<class InputIterator>
+        void insert(InputIterator first, InputIterator last)
+        {
+            size_type oldSize = _values.size();
+
+            _values.insert(_values.end(), first, last);
+
+            std::sort(_values.begin() + oldSize, _values.end(), _comp);
+            std::inplace_merge(_values.begin(), _values.begin() + oldSize, _values.end(), _comp);
+
+            unique();
+        }
+
+        // Appends a value that must be greater than every value in the set,
+        // as produced by the sorted set algorithms.
+        void push_back(const T& val)
+        {
+            assert(_values.empty() || _comp(_values.back(), val));
+
+            _values.push_back(val);
+        }
+
+        iterator erase(const_iterator pos)
+        {
+            return _values.erase(_values.begin() + (pos - begin()));
+        }
+
+        iterator erase(const_iterator first, const_iterator last)
+        {
+            return _values.erase(_values.begin() + (first - begin()),
+                                 _values.begin() + (last - begin()));
+        }
+
+        size_type erase(const T& val)
+        {
+            auto it = find(val);
+
+            if (it == end())
+            {
+                return 0;
+            }
+
+            erase(it);
+
+            return 1;
+        }
+
+        const_iterator lower_bound(const T& val) const
+        {
+            return std::lower_bound(_values.begin(), _values.end(), val, _comp);
+        }
+
+        const_iterator upper_bound(const T& val) const
+        {
+            return std::upper_bound(_values.begin(), _values.end(), val, _comp);
+        }
+
+        const_iterator find(const T& val) const
+        {
+            auto it = lower_bound(val);
+
+            return it != end() && !_comp(val, *it) ? it : end();
+        }
+
+        size_type count(const T& val) const
+        {
+            return find(val) != end() ? 1 : 0;
+        }
+
+        bool contains(const T& val) const
+        {
+            return find(val) != end();
+        }
+
+        // Moves the underlying vector out, leaving the set empty.
+        container_type extract()
+        {
+            container_type result;
+
+            result.swap(_values);
+
+            return result;
+        }
+
+        // Takes over a vector that is already sorted and unique.
+        void adopt_sorted(container_type&& values)
+        {
+            _values = std::move(values);
+
+            assert(std::adjacent_find(_values.begin(), _values.end(),
+                [this](const T& lhs, const T& rhs) { return !_comp(lhs, rhs); }) == _values.end());
+        }
+
+        void swap(flat_set& other)
+        {
+            std::swap(_comp, other._comp);
+            _values.swap(other._values);
+        }
+
+        bool operator==(const flat_set& rhs) const
+        {
+            return _values == rhs._values;
+        }
+
+        bool operator!=(const flat_set& rhs) const
+        {
+            return _values != rhs._values;
+        }
+
+        bool operator<(const flat_set& rhs) const
+        {
+            return _values < rhs._values;
+        }
+
+    private:
+        void normalize()
+        {
+            std::sort(_values.begin(), _values.end(), _comp);
+
+            unique();
+        }
+
+        void unique()
+        {
+            Compare comp = _comp;
+
+            _values.erase(std::unique(_values.begin(), _values.end(),
+                [comp](const T& lhs, const T& rhs) { return !comp(lhs, rhs); }),
+                _values.end());
+        }
+
+        Compare         _comp;
+        container_type  _values;
+    };
+}
+
+#endif
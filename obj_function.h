@@ -28,12 +28,17 @@
 #ifndef __OBJ_FUNCTION_H__
 #define __OBJ_FUNCTION_H__
 
+#include <assert.h>
+
 #include <functional>
+#include <memory>
 
 namespace obj
 {
     class function_wrapper
     {
+    public:
+        
         virtual ~function_wrapper() {};
     };
     
@@ -42,12 +47,17 @@ namespace obj
     {
     public:
         
-        function(std::function<R(A...)> fn) :
+        typed_function_wrapper() :
+            _fn()
+        {
+        }
+        
+        typed_function_wrapper(std::function<R(A...)> fn) :
             _fn(fn)
         {
         }
         
-        R operator()(A... args)
+        R operator()(A... args) const
         {
             return _fn(args...);
         }
@@ -68,14 +78,25 @@ namespace obj
             
         }
         
+        // The wrapper if the function has exactly the signature R(A...),
+        // otherwise null. Check once and keep the result rather than paying
+        // for the cast on every call.
+        template<typename R, typename... A>
+        const typed_function_wrapper<R, A...>* as() const
+        {
+            return dynamic_cast<const typed_function_wrapper<R, A...>*>(_wrappedFn.get());
+        }
+        
         template<typename R, typename... A>
-        R operator()(A... args)
+        R operator()(A... args) const
         {
-            assert(isA<typed_function_wrapper<R, A...>(_wrappedFn));
+            const typed_function_wrapper<R, A...>* fn = as<R, A...>();
+            
+            assert(fn);
             
-            if (isA<typed_function_wrapper<R, A...>(_wrappedFn))
+            if (fn)
             {
-                return asA<typed_function_wrapper<R, A...>(_wrappedFn)(args);
+                return (*fn)(args...);
             }
             else
             {
@@ -85,7 +106,7 @@ namespace obj
         
         
     private:
-        unique_ptr<function_wrapper> _wrappedFn;
+        std::unique_ptr<function_wrapper> _wrappedFn;
     };
 }
 
@@ -0,0 +1,249 @@
+//
+// obj_intern.h
+// Passageways
+//
+// Copyright (c) 2015 Vincent Tourangeau.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+#ifndef __OBJ_INTERN_H__
+#define __OBJ_INTERN_H__
+
+#include <obj_property.h>
+#include <obj_reflection.h>
+
+#include <cstddef>
+#include <functional>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <unordered_set>
+
+namespace obj
+{
+    // Interned strings
+    //
+    // Each distinct string value is stored once, in a process-wide pool,
+    // and an interned_string is a pointer to it: copying, assigning and
+    // comparing for equality cost a pointer, which makes them cheap values
+    // for properties holding recurring names:
+    //
+    //     obj::property<obj::interned_string> state;
+    //     state = "running";
+    //
+    // Interning a string looks it up under a lock. Strings are never
+    // removed from the pool, so it suits bounded sets of values, not
+    // arbitrary user input.
+
+    class intern_pool
+    {
+    public:
+        static intern_pool& get()
+        {
+            static intern_pool instance;
+
+            return instance;
+        }
+
+        const std::string* intern(const std::string& str)
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+
+            auto inserted = _strings.insert(str);
+
+            if (inserted.second)
+            {
+                _bytes += footprint(*inserted.first);
+            }
+
+            return &*inserted.first;
+        }
+
+        std::size_t size() const
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+
+            return _strings.size();
+        }
+
+        // An estimate of the memory held by the pool: the strings, their
+        // heap buffers when they have one, and a node and bucket per string.
+        std::size_t bytes() const
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+
+            return _bytes + _strings.bucket_count() * sizeof(void*);
+        }
+
+    private:
+        intern_pool() :
+            _bytes(0),
+            _mutex(),
+            _strings()
+        {
+        }
+
+        intern_pool(const intern_pool&);
+
+        static std::size_t footprint(const std::string& str)
+        {
+            std::size_t buffer = str.capacity() + 1;
+
+            // Short strings live inside the string object itself.
+            bool inline_buffer =
+                str.data() >= reinterpret_cast<const char*>(&str) &&
+                str.data() < reinterpret_cast<const char*>(&str + 1);
+
+            return sizeof(std::string) + 2 * sizeof(void*) + (inline_buffer ? 0 : buffer);
+        }
+
+        std::size_t                     _bytes;
+        mutable std::mutex              _mutex;
+        std::unordered_set<std::string> _strings;
+    };
+
+    class interned_string
+    {
+    public:
+        interned_string() :
+            _str(empty_string())
+        {
+        }
+
+        interned_string(const std::string& str) :
+            _str(intern_pool::get().intern(str))
+        {
+        }
+
+        interned_string(const char* str) :
+            _str(intern_pool::get().intern(str))
+        {
+        }
+
+        const std::string& str() const
+        {
+            return *_str;
+        }
+
+        operator const std::string&() const
+        {
+            return *_str;
+        }
+
+        const char* c_str() const
+        {
+            return _str->c_str();
+        }
+
+        std::size_t size() const
+        {
+            return _str->size();
+        }
+
+        bool empty() const
+        {
+            return _str->empty();
+        }
+
+        bool operator==(const interned_string& rhs) const
+        {
+            return _str == rhs._str;
+        }
+
+        bool operator!=(const interned_string& rhs) const
+        {
+            return _str != rhs._str;
+        }
+
+        // Ordered by value, so sorted containers sort alphabetically.
+        bool operator<(const interned_string& rhs) const
+        {
+            return _str != rhs._str && *_str < *rhs._str;
+        }
+
+        const std::string* pointer() const
+        {
+            return _str;
+        }
+
+    private:
+        static const std::string* empty_string()
+        {
+            static const std::string* empty = intern_pool::get().intern(std::string());
+
+            return empty;
+        }
+
+        const std::string* _str;
+    };
+
+    inline std::ostream& operator<<(std::ostream& out, const interned_string& str)
+    {
+        return out << str.str();
+    }
+
+    template<>
+    struct compare<interned_string>
+    {
+        static bool equal(const interned_string& lhs, const interned_string& rhs)
+        {
+            return lhs.pointer() == rhs.pointer();
+        }
+    };
+
+    // The pointer only means something in this process: the characters are
+    // written and interned again when read back.
+    template<>
+    struct serializer<interned_string>
+    {
+        static void write(std::vector<char>& out, const interned_string& val)
+        {
+            serializer<std::string>::write(out, val.str());
+        }
+
+        static bool read(const char*& in, const char* end, interned_string& val)
+        {
+            std::string str;
+
+            if (!serializer<std::string>::read(in, end, str))
+            {
+                return false;
+            }
+
+            val = interned_string(str);
+
+            return true;
+        }
+    };
+}
+
+namespace std
+{
+    template<>
+    struct hash<obj::interned_string>
+    {
+        std::size_t operator()(const obj::interned_string& str) const
+        {
+            return std::hash<const std::string*>()(str.pointer());
+        }
+    };
+}
+
+#endif
@@ -0,0 +1,319 @@
+//
+// obj_journal.h
+// Passageways
+//
+// Copyright (c) 2014 Vincent Tourangeau.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+#ifndef __OBJ_JOURNAL_H__
+#define __OBJ_JOURNAL_H__
+
+#include <obj_property.h>
+
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+namespace obj
+{
+    template<typename T>
+    class journal_target
+    {
+    public:
+        virtual ~journal_target() {}
+
+        // Exchanges the current value with val and notifies listeners, with
+        // the value that was current passed as the old one.
+        virtual void swap_value(T& val) = 0;
+    };
+
+    // A fixed-capacity ring of old values shared by any number of
+    // properties holding a T. Assignments move the outgoing value into the
+    // ring; undo swaps it back in, leaving the undone value in place for
+    // redo. Once full, the oldest entries are overwritten. The journal must
+    // outlive the properties attached to it.
+
+    template<typename T>
+    class change_journal
+    {
+    public:
+        using checkpoint = std::uint64_t;
+
+        change_journal(std::size_t capacity) :
+            _begin(0),
+            _end(0),
+            _entries(capacity),
+            _pos(0),
+            _replaying(false)
+        {
+            assert(capacity > 0);
+        }
+
+        std::size_t capacity() const
+        {
+            return _entries.size();
+        }
+
+        checkpoint mark() const
+        {
+            return _pos;
+        }
+
+        // True while undoing or redoing, when changes are not recorded.
+        bool replaying() const
+        {
+            return _replaying;
+        }
+
+        bool can_undo() const
+        {
+            return _pos != _begin;
+        }
+
+        bool can_redo() const
+        {
+            return _pos != _end;
+        }
+
+        bool undo()
+        {
+            if (!can_undo())
+            {
+                return false;
+            }
+
+            replay(entry_at(--_pos));
+
+            return true;
+        }
+
+        bool redo()
+        {
+            if (!can_redo())
+            {
+                return false;
+            }
+
+            replay(entry_at(_pos++));
+
+            return true;
+        }
+
+        // Undoes or redoes until the journal is back at cp. Returns false if
+        // cp has been overwritten or discarded, after going as far as
+        // possible.
+        bool rewind(checkpoint cp)
+        {
+            while (_pos > cp && undo())
+            {
+            }
+
+            while (_pos < cp && redo())
+            {
+            }
+
+            return _pos == cp;
+        }
+
+        void clear()
+        {
+            _begin = _end = _pos;
+        }
+
+        // Records val as the old value of target, returning the stored copy.
+        // Returns null while undoing or redoing, in which case nothing is
+        // recorded.
+        T* record(journal_target<T>& target, T&& val)
+        {
+            if (_replaying)
+            {
+                return nullptr;
+            }
+
+            if (_pos - _begin == _entries.size())
+            {
+                ++_begin;
+            }
+
+            entry& e = entry_at(_pos++);
+
+            e._target = &target;
+            e._value = std::move(val);
+
+            _end = _pos;
+
+            return &e._value;
+        }
+
+        void forget(const journal_target<T>& target)
+        {
+            for (auto& e : _entries)
+            {
+                if (e._target == &target)
+                {
+                    e._target = nullptr;
+                }
+            }
+        }
+
+    private:
+        struct entry
+        {
+            entry() :
+                _target(nullptr),
+                _value()
+            {
+            }
+
+            journal_target<T>*  _target;
+            T                   _value;
+        };
+
+        change_journal(const change_journal&);
+
+        entry& entry_at(std::uint64_t seq)
+        {
+            return _entries[seq % _entries.size()];
+        }
+
+        void replay(entry& e)
+        {
+            if (e._target)
+            {
+                bool oldReplaying = _replaying;
+
+                _replaying = true;
+                e._target->swap_value(e._value);
+                _replaying = oldReplaying;
+            }
+        }
+
+        std::uint64_t       _begin;
+        std::uint64_t       _end;
+        std::vector<entry>  _entries;
+        std::uint64_t       _pos;
+        bool                _replaying;
+    };
+
+    template<typename T, var_return_type V, template<class> class S, class C>
+    class basic_journaled_property : public basic_property<T,V,S,C>,
+                                     public journal_target<T>
+    {
+
+    public:
+        basic_journaled_property() :
+            basic_property<T,V,S,C>(),
+            _journal(nullptr)
+        {
+        }
+
+        basic_journaled_property(const T& val) :
+            basic_property<T,V,S,C>(val),
+            _journal(nullptr)
+        {
+        }
+
+        basic_journaled_property(change_journal<T>& journal, const T& val = T()) :
+            basic_property<T,V,S,C>(val),
+            _journal(&journal)
+        {
+        }
+
+        basic_journaled_property(const basic_journaled_property& other) :
+            basic_property<T,V,S,C>(other),
+            _journal(other._journal)
+        {
+        }
+
+        ~basic_journaled_property()
+        {
+            if (_journal)
+            {
+                _journal->forget(*this);
+            }
+        }
+
+        basic_journaled_property<T,V,S,C>&
+        operator=(const basic_journaled_property& rhs)
+        {
+            return *this = rhs._val;
+        }
+
+        basic_journaled_property<T,V,S,C>&
+        operator=(const T& rhs)
+        {
+            if (!_journal || _journal->replaying())
+            {
+                basic_property<T,V,S,C>::operator=(rhs);
+                return *this;
+            }
+
+            if (!compare<T>::equal(this->_val, rhs))
+            {
+                // Recorded after the listeners run: they may record into the
+                // same journal, overwriting the entry the old value went to.
+                change_journal<T>* journal = _journal;
+                T oldVal(take_old(this->_val, rhs));
+
+                this->_val = rhs;
+                this->_changedSig(this->_val);
+                this->_changedSig2(this->_val, oldVal);
+
+                journal->record(*this, std::move(oldVal));
+            }
+
+            return *this;
+        }
+
+        change_journal<T>* journal() const
+        {
+            return _journal;
+        }
+
+        void set_journal(change_journal<T>* journal)
+        {
+            if (_journal)
+            {
+                _journal->forget(*this);
+            }
+
+            _journal = journal;
+        }
+
+    private:
+        void swap_value(T& val)
+        {
+            using std::swap;
+
+            swap(this->_val, val);
+
+            this->_changedSig(this->_val);
+            this->_changedSig2(this->_val, val);
+        }
+
+        change_journal<T>*  _journal;
+    };
+
+    template<typename T> using journaled_property =
+        basic_journaled_property<T, var_return_type::ref, obj::signal, obj::connection>;
+}
+
+#endif
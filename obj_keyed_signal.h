@@ -0,0 +1,252 @@
+//
+// obj_keyed_signal.h
+// Passageways
+//
+// Copyright (c) 2015 Vincent Tourangeau.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+#ifndef __OBJ_KEYED_SIGNAL_H__
+#define __OBJ_KEYED_SIGNAL_H__
+
+#include <obj_signal.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <utility>
+#include <vector>
+
+namespace obj
+{
+    // keyed signals
+    //
+    // One signal per key behind an open-addressing index, so an emission
+    // for a key only reaches the slots connected to that key, plus any
+    // wildcard slots, which receive the key as their first argument.
+    // Connections are ordinary obj::connection objects from the per-key
+    // signals, so they work with observer and can be disconnected as usual.
+    //
+    //     obj::keyed_signal<std::string, void(double)> prices;
+    //
+    //     prices.connect("ACME", onAcme);
+    //     prices.connect_all(onAnyPrice);
+    //     prices("ACME", 12.5);
+
+    template<typename Key, typename T, typename Hash = std::hash<Key>>
+    class keyed_signal
+    {
+    };
+
+    template<typename Key, typename... ArgTypes, typename Hash>
+    class keyed_signal<Key, void(ArgTypes...), Hash>
+    {
+    public:
+        using signal_type = signal<void(ArgTypes...)>;
+        using slot = std::function<void(ArgTypes...)>;
+        using wildcard_slot = std::function<void(const Key&, ArgTypes...)>;
+
+        keyed_signal() :
+            _calling(0),
+            _count(0),
+            _entries(16),
+            _hash(),
+            _shift(64 - 4),
+            _wildcard()
+        {
+        }
+
+        template<typename... Args>
+        connection connect(const Key& key, const slot& fn, Args&&... args)
+        {
+            return signal_for(key).connect(fn, std::forward<Args>(args)...);
+        }
+
+        template<typename... Args>
+        connection connect_all(const wildcard_slot& fn, Args&&... args)
+        {
+            return _wildcard.connect(fn, std::forward<Args>(args)...);
+        }
+
+        // Whether an emission for key would reach any slot.
+        bool connected(const Key& key) const
+        {
+            const signal_type* sig = find(key);
+
+            return (sig && sig->connected()) || _wildcard.connected();
+        }
+
+        void operator()(const Key& key, ArgTypes... args) const
+        {
+            ++_calling;
+
+            if (const signal_type* sig = find(key))
+            {
+                (*sig)(args...);
+            }
+
+            _wildcard(key, args...);
+
+            --_calling;
+        }
+
+        void disconnect_all()
+        {
+            for (auto& e : _entries)
+            {
+                if (e._signal)
+                {
+                    e._signal->disconnect_all();
+                }
+            }
+
+            _wildcard.disconnect_all();
+        }
+
+        // Drops the signals of keys with nothing left connected. Their
+        // entries are otherwise kept for the next subscriber to the key,
+        // until the index is about to grow, which drops them first unless
+        // it happens during an emission.
+        void compact()
+        {
+            if (_calling > 0)
+            {
+                return;
+            }
+
+            rehash(_entries.size(), true);
+        }
+
+    private:
+        struct entry
+        {
+            Key                             _key;
+            std::unique_ptr<signal_type>    _signal;
+        };
+
+        keyed_signal(const keyed_signal&);
+
+        keyed_signal& operator=(const keyed_signal&);
+
+        // Fibonacci hashing: std::hash is the identity for integers, so its
+        // low bits alone would put sequential or aligned keys in clusters.
+        std::size_t bucket(const Key& key) const
+        {
+            return static_cast<std::size_t>(
+                (static_cast<std::uint64_t>(_hash(key)) * 0x9E3779B97F4A7C15ull) >> _shift);
+        }
+
+        // The entry holding key, or the empty entry where it would go.
+        entry& probe(const Key& key)
+        {
+            std::size_t mask = _entries.size() - 1;
+            std::size_t i = bucket(key);
+
+            while (_entries[i]._signal && !(_entries[i]._key == key))
+            {
+                i = (i + 1) & mask;
+            }
+
+            return _entries[i];
+        }
+
+        const signal_type* find(const Key& key) const
+        {
+            std::size_t mask = _entries.size() - 1;
+
+            for (std::size_t i = bucket(key); _entries[i]._signal; i = (i + 1) & mask)
+            {
+                if (_entries[i]._key == key)
+                {
+                    return _entries[i]._signal.get();
+                }
+            }
+
+            return nullptr;
+        }
+
+        // Signals are held by pointer so growing the index, even from a
+        // slot, never moves a signal that is emitting.
+        signal_type& signal_for(const Key& key)
+        {
+            if ((_count + 1) * 2 > _entries.size())
+            {
+                bool drop = _calling == 0;
+                std::size_t live = 0;
+
+                for (auto& e : _entries)
+                {
+                    if (e._signal && (!drop || e._signal->connected()))
+                    {
+                        ++live;
+                    }
+                }
+
+                // Grows unless dropping leaves the index at most a quarter
+                // full, so rehashes stay amortized O(1) under churn.
+                rehash((live + 1) * 4 > _entries.size() ? _entries.size() * 2 : _entries.size(), drop);
+            }
+
+            entry& e = probe(key);
+
+            if (!e._signal)
+            {
+                e._key = key;
+                e._signal.reset(new signal_type());
+                ++_count;
+            }
+
+            return *e._signal;
+        }
+
+        void rehash(std::size_t size, bool dropUnconnected)
+        {
+            std::vector<entry> old(size);
+            old.swap(_entries);
+
+            _count = 0;
+            _shift = 64;
+
+            for (std::size_t n = size; n > 1; n >>= 1)
+            {
+                --_shift;
+            }
+
+            for (auto& e : old)
+            {
+                if (e._signal && (!dropUnconnected || e._signal->connected()))
+                {
+                    probe(e._key) = std::move(e);
+                    ++_count;
+                }
+            }
+        }
+
+        mutable std::size_t                         _calling;
+        std::size_t                                 _count;
+        std::vector<entry>                          _entries;
+        Hash                                        _hash;
+        unsigned                                    _shift;
+        signal<void(const Key&, ArgTypes...)>       _wildcard;
+    };
+}
+
+#endif
@@ -0,0 +1,528 @@
+//
+// obj_mapped.h
+// Passageways
+//
+// Copyright (c) 2015 Vincent Tourangeau.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+#ifndef __OBJ_MAPPED_H__
+#define __OBJ_MAPPED_H__
+
+#include <obj_property.h>
+
+#include <assert.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <type_traits>
+
+namespace obj
+{
+    // Property state kept in memory-mapped files (POSIX). A restarted
+    // process maps the file again and finds its values where it left them;
+    // pages are read in as they are touched.
+    //
+    // Writes to a mapped_file reach the file whenever the system flushes
+    // the pages; sync() forces them out and waits. A crash can leave any
+    // mix of old and new values in it. mapped_array adds checkpoints that
+    // survive crashes.
+
+    class mapped_file
+    {
+    public:
+        mapped_file() :
+            _created(false),
+            _data(nullptr),
+            _fd(-1),
+            _size(0)
+        {
+        }
+
+        // Maps size bytes of the file at path, creating or extending it
+        // with zeros as needed. A size of 0 maps the whole existing file.
+        mapped_file(const std::string& path, std::size_t size) :
+            mapped_file()
+        {
+            open(path, size);
+        }
+
+        mapped_file(mapped_file&& other) :
+            _created(other._created),
+            _data(other._data),
+            _fd(other._fd),
+            _size(other._size)
+        {
+            other._data = nullptr;
+            other._fd = -1;
+            other._size = 0;
+        }
+
+        mapped_file& operator=(mapped_file&& other)
+        {
+            if (this != &other)
+            {
+                close();
+
+                std::swap(_created, other._created);
+                std::swap(_data, other._data);
+                std::swap(_fd, other._fd);
+                std::swap(_size, other._size);
+            }
+
+            return *this;
+        }
+
+        ~mapped_file()
+        {
+            close();
+        }
+
+        bool open(const std::string& path, std::size_t size)
+        {
+            close();
+
+            _fd = ::open(path.c_str(), O_RDWR | O_CREAT, 0644);
+
+            if (_fd < 0)
+            {
+                return false;
+            }
+
+            struct stat st;
+
+            if (::fstat(_fd, &st) != 0)
+            {
+                close();
+                return false;
+            }
+
+            std::size_t existing = static_cast<std::size_t>(st.st_size);
+
+            _created = existing == 0;
+
+            if (size == 0)
+            {
+                size = existing;
+            }
+
+            if ((existing < size && ::ftruncate(_fd, static_cast<off_t>(size)) != 0) || size == 0)
+            {
+                close();
+                return false;
+            }
+
+            void* data = ::mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, _fd, 0);
+
+            if (data == MAP_FAILED)
+            {
+                close();
+                return false;
+            }
+
+            _data = static_cast<char*>(data);
+            _size = size;
+
+            return true;
+        }
+
+        void close()
+        {
+            if (_data)
+            {
+                ::munmap(_data, _size);
+            }
+
+            if (_fd >= 0)
+            {
+                ::close(_fd);
+            }
+
+            _data = nullptr;
+            _fd = -1;
+            _size = 0;
+        }
+
+        bool is_open() const
+        {
+            return _data != nullptr;
+        }
+
+        // Whether open() found the file empty or missing.
+        bool created() const
+        {
+            return _created;
+        }
+
+        char* data() const
+        {
+            return _data;
+        }
+
+        std::size_t size() const
+        {
+            return _size;
+        }
+
+        template<typename T>
+        T& get(std::size_t offset) const
+        {
+            assert(offset + sizeof(T) <= _size);
+            assert(offset % alignof(T) == 0);
+
+            return *reinterpret_cast<T*>(_data + offset);
+        }
+
+        // Writes the pages overlapping [offset, offset + length) to the file
+        // and waits for them.
+        bool sync(std::size_t offset, std::size_t length) const
+        {
+            if (!_data || length == 0)
+            {
+                return _data != nullptr;
+            }
+
+            std::size_t page = static_cast<std::size_t>(::sysconf(_SC_PAGESIZE));
+            std::size_t first = offset / page * page;
+
+            return ::msync(_data + first, offset + length - first, MS_SYNC) == 0;
+        }
+
+        bool sync() const
+        {
+            return sync(0, _size);
+        }
+
+    private:
+        mapped_file(const mapped_file&);
+
+        mapped_file& operator=(const mapped_file&);
+
+        bool        _created;
+        char*       _data;
+        int         _fd;
+        std::size_t _size;
+    };
+
+    // An array of trivially copyable values in a mapped file, usable as the
+    // Storage of a property_array:
+    //
+    //     obj::property_array<double, obj::mapped_array<double>>
+    //         prices(obj::mapped_array<double>("prices.dat", 1000000));
+    //
+    // The file starts with a small header recording the element size and
+    // count. A file that is new, or was written for another element size,
+    // is filled with val; so are elements past the count it was last
+    // opened with.
+    //
+    // The values live in a working region followed by two snapshot
+    // regions, so the file is three times the size of the array.
+    // checkpoint() copies the values into the snapshot not holding the
+    // last checkpoint, flushes it, then flips the header to it. Closing
+    // the array flushes the working region and marks the file clean.
+    // Opening a file that was not closed cleanly, after a crash, restores
+    // the last checkpoint: the values written after it are lost, but
+    // they never show up half written. The header fits in one disk
+    // sector, which is assumed to be written atomically. Reopening with
+    // another count moves the snapshots, and is not crash safe.
+
+    template<typename T>
+    class mapped_array
+    {
+        static_assert(std::is_trivially_copyable<T>::value,
+                      "mapped_array needs a trivially copyable type");
+        static_assert(alignof(T) <= 64,
+                      "mapped_array elements are aligned to at most 64 bytes");
+
+    public:
+        using value_type = T;
+
+        mapped_array(const std::string& path, std::size_t size, const T& val = T()) :
+            _file(path, file_size(size)),
+            _size(_file.is_open() ? size : 0)
+        {
+            if (!_file.is_open())
+            {
+                return;
+            }
+
+            header& h = _file.get<header>(0);
+
+            if (_file.created() || h._magic != magic || h._elementSize != sizeof(T))
+            {
+                h._checkpoints = 0;
+                h._clean = 1;
+                h._elementSize = sizeof(T);
+                h._magic = magic;
+                h._size = 0;
+            }
+
+            std::size_t kept = static_cast<std::size_t>(std::min<std::uint64_t>(h._size, size));
+
+            if (!h._clean && h._checkpoints > 0)
+            {
+                // The snapshot regions of the old count may lie past the
+                // end of the new layout.
+                if (file_size(h._size) > _file.size() && !_file.open(path, file_size(h._size)))
+                {
+                    _size = 0;
+                    return;
+                }
+
+                header& old = _file.get<header>(0);
+                const T* committed = snapshot(old._size, (old._checkpoints - 1) % 2);
+
+                std::copy(committed, committed + kept, data());
+            }
+
+            header& current = _file.get<header>(0);
+
+            if (current._size != size)
+            {
+                current._checkpoints = 0;
+                current._size = size;
+            }
+
+            std::fill(data() + kept, data() + size, val);
+
+            current._clean = 0;
+            _file.sync(0, sizeof(header));
+        }
+
+        mapped_array(mapped_array&& other) :
+            _file(std::move(other._file)),
+            _size(other._size)
+        {
+            other._size = 0;
+        }
+
+        ~mapped_array()
+        {
+            if (_file.is_open() && _file.sync(header_size, _size * sizeof(T)))
+            {
+                _file.get<header>(0)._clean = 1;
+                _file.sync(0, sizeof(header));
+            }
+        }
+
+        bool is_open() const
+        {
+            return _file.is_open();
+        }
+
+        std::size_t size() const
+        {
+            return _size;
+        }
+
+        T* data()
+        {
+            return reinterpret_cast<T*>(_file.data() + header_size);
+        }
+
+        const T* data() const
+        {
+            return reinterpret_cast<const T*>(_file.data() + header_size);
+        }
+
+        T& operator[](std::size_t idx)
+        {
+            assert(idx < _size);
+
+            return data()[idx];
+        }
+
+        const T& operator[](std::size_t idx) const
+        {
+            assert(idx < _size);
+
+            return data()[idx];
+        }
+
+        // Copies the values into the snapshot not holding the last
+        // checkpoint and flushes it, then flushes the header naming it as
+        // the latest. Returns once both are on disk.
+        bool checkpoint()
+        {
+            if (!_file.is_open())
+            {
+                return false;
+            }
+
+            header& h = _file.get<header>(0);
+            std::size_t next = h._checkpoints % 2;
+
+            std::copy(data(), data() + _size, snapshot(_size, next));
+
+            if (!_file.sync(snapshot_offset(_size, next), _size * sizeof(T)))
+            {
+                return false;
+            }
+
+            ++h._checkpoints;
+
+            return _file.sync(0, sizeof(header));
+        }
+
+        std::uint64_t checkpoints() const
+        {
+            return _file.is_open() ? _file.get<header>(0)._checkpoints : 0;
+        }
+
+    private:
+        struct header
+        {
+            std::uint64_t   _checkpoints;
+            std::uint32_t   _clean;
+            std::uint32_t   _elementSize;
+            std::uint32_t   _magic;
+            std::uint64_t   _size;
+        };
+
+        static const std::uint32_t magic = 0x6f626a32;
+        static const std::size_t header_size = 64;
+
+        mapped_array(const mapped_array&);
+
+        // Regions start on 64 byte boundaries, so elements stay aligned.
+        static std::size_t region_size(std::uint64_t size)
+        {
+            return static_cast<std::size_t>((size * sizeof(T) + 63) / 64 * 64);
+        }
+
+        static std::size_t file_size(std::uint64_t size)
+        {
+            return header_size + 3 * region_size(size);
+        }
+
+        static std::size_t snapshot_offset(std::uint64_t size, std::size_t idx)
+        {
+            return header_size + (1 + idx) * region_size(size);
+        }
+
+        T* snapshot(std::uint64_t size, std::size_t idx)
+        {
+            return reinterpret_cast<T*>(_file.data() + snapshot_offset(size, idx));
+        }
+
+        mapped_file _file;
+        std::size_t _size;
+    };
+
+    // A property whose value lives outside the object, typically in a
+    // mapped file: assignments write through and fire the usual signals.
+    // It reads like the other properties, so it can be reflected, bound
+    // and published.
+    //
+    //     obj::mapped_file state("state.dat", 4096);
+    //     obj::mapped_property<int> version(state.get<int>(0));
+
+    template<typename T, template<class> class S, class C>
+    class basic_mapped_property
+    {
+        static_assert(std::is_trivially_copyable<T>::value,
+                      "mapped properties need a trivially copyable type");
+
+    public:
+        using ReturnT = T;
+        using ConstReturnT = T;
+
+        explicit basic_mapped_property(T& location) :
+            _val(&location)
+        {
+        }
+
+        operator ConstReturnT() const
+        {
+            return *_val;
+        }
+
+        ConstReturnT operator()() const
+        {
+            return *_val;
+        }
+
+        basic_mapped_property& operator=(const T& rhs)
+        {
+            if (!compare<T>::equal(*_val, rhs))
+            {
+                OBJ_TRACE_SCOPE("property", this);
+
+                T oldVal = *_val;
+
+                *_val = rhs;
+                _changedSig(*_val);
+                _changedSig2(*_val, oldVal);
+            }
+
+            return *this;
+        }
+
+        C
+        connect(const std::function<void(const T&)>& fn)
+        {
+            return _changedSig.connect(fn);
+        }
+
+        template<class... Args>
+        C
+        connect(const std::function<void(const T&)>& fn, Args... args)
+        {
+            return _changedSig.connect(fn, args...);
+        }
+
+        C
+        connect(const std::function<void(const T&, const T&)>& fn)
+        {
+            return _changedSig2.connect(fn);
+        }
+
+        template<class... Args>
+        C
+        connect(const std::function<void(const T&, const T&)>& fn, Args... args)
+        {
+            return _changedSig2.connect(fn, args...);
+        }
+
+        void disconnect_all()
+        {
+            _changedSig.disconnect_all();
+            _changedSig2.disconnect_all();
+        }
+
+    private:
+        basic_mapped_property(const basic_mapped_property&);
+
+        S<void(const T&)>           _changedSig;
+        S<void(const T&, const T&)> _changedSig2;
+        T*                          _val;
+    };
+
+    template<typename T> using mapped_property =
+        basic_mapped_property<T, signal, connection>;
+}
+
+#endif
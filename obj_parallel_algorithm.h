@@ -0,0 +1,185 @@
+//
+// obj_parallel_algorithm.h
+// Passageways
+//
+// Copyright (c) 2015 Vincent Tourangeau.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+#ifndef __OBJ_PARALLEL_ALGORITHM_H__
+#define __OBJ_PARALLEL_ALGORITHM_H__
+
+#include <obj_algorithm.h>
+#include <obj_thread_pool.h>
+
+namespace obj
+{
+    // Overloads of the obj_algorithm.h wrappers that split random access
+    // containers into chunks run on a thread_pool. Results keep the order
+    // of the serial versions: chunks are filtered or transformed into
+    // buffers of their own, then appended in chunk order.
+
+    template<class C, class Fn>
+    void for_each(thread_pool& pool, C& c, Fn fn)
+    {
+        auto first = c.begin();
+
+        pool.parallel_for(c.size(), pool.grain_for(c.size()),
+        [first, &fn](std::size_t begin, std::size_t end)
+        {
+            std::for_each(first + begin, first + end, fn);
+        });
+    }
+
+    template<class C, class Pred>
+    auto find_if(thread_pool& pool, const C& c, Pred pred) -> decltype(c.begin())
+    {
+        auto first = c.begin();
+        std::atomic<std::size_t> found(c.size());
+
+        // Chunks past the best match found so far are skipped, and chunks
+        // in progress stop scanning once they pass it.
+        pool.parallel_for(c.size(), pool.grain_for(c.size()),
+        [first, &pred, &found](std::size_t begin, std::size_t end)
+        {
+            for (std::size_t i = begin; i < end; ++i)
+            {
+                std::size_t best = found.load(std::memory_order_relaxed);
+
+                if (i >= best)
+                {
+                    return;
+                }
+
+                if (pred(*(first + i)))
+                {
+                    while (i < best &&
+                           !found.compare_exchange_weak(best, i, std::memory_order_relaxed))
+                    {
+                    }
+
+                    return;
+                }
+            }
+        });
+
+        return first + found.load();
+    }
+
+    template<class C1, class C2, class Fn>
+    C1 transform(thread_pool& pool, const C2& source, Fn fn)
+    {
+        using value_type = typename std::decay<decltype(fn(*source.begin()))>::type;
+
+        auto first = source.begin();
+        std::size_t grain = pool.grain_for(source.size());
+        std::vector<std::vector<value_type>> chunks((source.size() + grain - 1) / grain);
+
+        pool.parallel_for(source.size(), grain,
+        [first, grain, &fn, &chunks](std::size_t begin, std::size_t end)
+        {
+            std::vector<value_type>& out = chunks[begin / grain];
+
+            out.reserve(end - begin);
+
+            std::transform(first + begin, first + end, std::back_inserter(out), fn);
+        });
+
+        C1 result;
+        details::reserve(result, source.size(), 0);
+
+        auto out = details::appender(result, 0);
+
+        for (auto& chunk : chunks)
+        {
+            out = std::move(chunk.begin(), chunk.end(), out);
+        }
+
+        return result;
+    }
+
+    template<class C, class Pred>
+    C copy_if(thread_pool& pool, const C& source, Pred pred)
+    {
+        using value_type = typename C::value_type;
+
+        auto first = source.begin();
+        std::size_t grain = pool.grain_for(source.size());
+        std::vector<std::vector<value_type>> chunks((source.size() + grain - 1) / grain);
+
+        pool.parallel_for(source.size(), grain,
+        [first, grain, &pred, &chunks](std::size_t begin, std::size_t end)
+        {
+            std::copy_if(first + begin, first + end,
+                         std::back_inserter(chunks[begin / grain]), pred);
+        });
+
+        std::size_t size = 0;
+
+        for (const auto& chunk : chunks)
+        {
+            size += chunk.size();
+        }
+
+        C result;
+        details::reserve(result, size, 0);
+
+        auto out = details::appender(result, 0);
+
+        for (auto& chunk : chunks)
+        {
+            out = std::move(chunk.begin(), chunk.end(), out);
+        }
+
+        return result;
+    }
+
+    // Each chunk compacts its survivors to its own front in parallel; the
+    // chunks are then slid together in order.
+    template<class C, class Pred>
+    void remove_if(thread_pool& pool, C& c, Pred pred)
+    {
+        auto first = c.begin();
+        std::size_t grain = pool.grain_for(c.size());
+        std::vector<std::size_t> kept((c.size() + grain - 1) / grain);
+
+        pool.parallel_for(c.size(), grain,
+        [first, grain, &pred, &kept](std::size_t begin, std::size_t end)
+        {
+            auto newEnd = std::remove_if(first + begin, first + end, pred);
+
+            kept[begin / grain] = newEnd - (first + begin);
+        });
+
+        auto out = first;
+
+        for (std::size_t i = 0; i < kept.size(); ++i)
+        {
+            auto chunk = first + i * grain;
+
+            out = out == chunk ? out + kept[i] :
+                std::move(chunk, chunk + kept[i], out);
+        }
+
+        c.erase(out, c.end());
+    }
+}
+
+#endif
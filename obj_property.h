@@ -28,6 +28,11 @@
 
 #include <obj_signal.h>
 
+#include <cstddef>
+#include <memory>
+#include <type_traits>
+#include <utility>
+
 namespace obj
 {
     class connection;
@@ -72,6 +77,29 @@ namespace obj
         using type = const T&;
     };
     
+    // The value type of any property, as read through operator()(). There is
+    // no type for anything else, so overloads taking any property can leave
+    // other arguments alone.
+    template<typename P, typename = void>
+    struct property_value
+    {
+    };
+    
+    template<typename P>
+    struct property_value<P, typename std::conditional<true, void, decltype(std::declval<const P&>()())>::type>
+    {
+        using type = typename std::decay<decltype(std::declval<const P&>()())>::type;
+    };
+    
+    // Moves a property's old value out before it is overwritten with rhs,
+    // unless rhs is the value itself: compare<T> need not find a value
+    // equal to itself, and std::function never does.
+    template<typename T>
+    T take_old(T& val, const T& rhs)
+    {
+        return &rhs == &val ? T(val) : T(std::move(val));
+    }
+    
     enum class indirection_type
     {
         same,
@@ -333,20 +361,20 @@ namespace obj
         {
             if (!compare<T>::equal(this->_val, rhs))
             {
-                T* oldVal = nullptr;
+                OBJ_TRACE_SCOPE("property", this);
                 
                 if (this->_changedSig2.connected())
                 {
-                    oldVal = new T(this->_val);
+                    T oldVal(take_old(this->_val, rhs));
+                    
+                    this->_val = rhs;
+                    this->_changedSig(this->_val);
+                    this->_changedSig2(this->_val, oldVal);
                 }
-                
-                this->_val = rhs;
-                this->_changedSig(this->_val);
-                
-                if (oldVal)
+                else
                 {
-                    this->_changedSig2(this->_val, *oldVal);
-                    delete oldVal;
+                    this->_val = rhs;
+                    this->_changedSig(this->_val);
                 }
             }
             
@@ -389,7 +417,131 @@ namespace obj
         S<void(const T&)>           _changedSig;
         S<void(const T&, const T&)> _changedSig2;
     };
-    
+
+    // lazy properties
+    //
+    // Same interface as basic_property, but both signals live in a side
+    // block that is only allocated on the first connect. A property nobody
+    // listens to is its value plus a null pointer.
+
+    template<typename T, template<class> class S>
+    struct lazy_signals
+    {
+        S<void(const T&)>           _changedSig;
+        S<void(const T&, const T&)> _changedSig2;
+    };
+
+    template<typename T, var_return_type V, template<class> class S, class C>
+    class basic_lazy_property : public basic_property_base<T,V>
+    {
+
+    public:
+        basic_lazy_property() :
+            basic_property_base<T,V>()
+        {
+        }
+
+        basic_lazy_property(const T& val) :
+            basic_property_base<T,V>(val)
+        {
+        }
+
+        basic_lazy_property(const basic_lazy_property& other) :
+            basic_property_base<T, V>(other)
+        {
+        }
+
+        basic_lazy_property<T,V,S,C>&
+        operator=(const basic_lazy_property& rhs)
+        {
+            return *this = rhs._val;
+        }
+
+        basic_lazy_property<T,V,S,C>&
+        operator=(const T& rhs)
+        {
+            if (!compare<T>::equal(this->_val, rhs))
+            {
+                if (!_signals)
+                {
+                    this->_val = rhs;
+                    return *this;
+                }
+
+                if (_signals->_changedSig2.connected())
+                {
+                    T oldVal(take_old(this->_val, rhs));
+
+                    this->_val = rhs;
+                    _signals->_changedSig(this->_val);
+                    _signals->_changedSig2(this->_val, oldVal);
+                }
+                else
+                {
+                    this->_val = rhs;
+                    _signals->_changedSig(this->_val);
+                }
+            }
+
+            return *this;
+        }
+
+        C
+        connect(const std::function<void(const T&)>& fn)
+        {
+            return signals()._changedSig.connect(fn);
+        }
+
+        template<class... Args>
+        C
+        connect(const std::function<void(const T&)>& fn, Args... args)
+        {
+            return signals()._changedSig.connect(fn, args...);
+        }
+
+        C
+        connect(const std::function<void(const T&, const T&)>& fn)
+        {
+            return signals()._changedSig2.connect(fn);
+        }
+
+        template<class... Args>
+        C
+        connect(const std::function<void(const T&, const T&)>& fn, Args... args)
+        {
+            return signals()._changedSig2.connect(fn, args...);
+        }
+
+        bool connected() const
+        {
+            return _signals &&
+                (_signals->_changedSig.connected() ||
+                 _signals->_changedSig2.connected());
+        }
+
+        void disconnect_all()
+        {
+            if (_signals)
+            {
+                _signals->_changedSig.disconnect_all();
+                _signals->_changedSig2.disconnect_all();
+            }
+        }
+
+    private:
+        lazy_signals<T,S>& signals()
+        {
+            if (!_signals)
+            {
+                _signals.reset(new lazy_signals<T,S>());
+            }
+
+            return *_signals;
+        }
+
+        std::unique_ptr<lazy_signals<T,S>> _signals;
+    };
+
     template<class T, class D, var_return_type V,
               template<class> class S, class C>
     class basic_dynamic_property :
@@ -421,12 +573,220 @@ namespace obj
         
         void(D::*_setter)(const T&);
     };
-    
+
+    // bound properties
+    //
+    // Dynamic properties whose getter, setter and position inside the owner
+    // are template parameters. The owner is recovered from the property's
+    // own address, so no pointers are stored and accessor calls inline.
+    // O returns the offset of the property member within D. It is usually
+    // a static member function of D wrapping offsetof, or member_offset()
+    // where D is not standard-layout, since the member cannot be named in
+    // its own declaration:
+    //
+    //     class Foo
+    //     {
+    //         static std::size_t x_offset() { return offsetof(Foo, x); }
+    //
+    //     public:
+    //         obj::bound_property<int, Foo, &Foo::getX, &Foo::setX, &Foo::x_offset> x;
+    //     };
+    //
+    // The signals live in a side block allocated on the first connect, so
+    // a bound property nobody listens to is a single null pointer.
+
+    // The offset of a member named only by a pointer to it, for where
+    // offsetof cannot be used. It is measured through storage holding no D,
+    // which is formally undefined: it works with the usual ABIs for classes
+    // without virtual bases. Prefer offsetof for standard-layout classes.
+    template<class D, class M>
+    std::size_t member_offset(M D::*member)
+    {
+        static const typename std::aligned_storage<sizeof(D), alignof(D)>::type storage = {};
+
+        const D* obj = reinterpret_cast<const D*>(&storage);
+
+        return reinterpret_cast<const char*>(&(obj->*member)) -
+               reinterpret_cast<const char*>(obj);
+    }
+
+    template<class T, class D, var_return_type V,
+             typename const_return_type<T,V>::type(D::*G)() const,
+             std::size_t(*O)(),
+             template<class> class S, class C>
+    class bound_property_base
+    {
+        friend D;
+
+    public:
+        using ReturnT = typename return_type<T,V>::type;
+        using ConstReturnT = typename const_return_type<T,V>::type;
+
+        bound_property_base()
+        {
+        }
+
+        bound_property_base(const bound_property_base&)
+        {
+        }
+
+        operator ReturnT()
+        {
+            return (owner()->*G)();
+        }
+
+        operator ConstReturnT() const
+        {
+            return (owner()->*G)();
+        }
+
+        ReturnT operator()()
+        {
+            return (owner()->*G)();
+        }
+
+        ConstReturnT operator()() const
+        {
+            return (owner()->*G)();
+        }
+
+        C
+        connect(const std::function<void(const T&)>& fn)
+        {
+            return signals()._changedSig.connect(fn);
+        }
+
+        template<class... Args>
+        C
+        connect(const std::function<void(const T&)>& fn, Args... args)
+        {
+            return signals()._changedSig.connect(fn, args...);
+        }
+
+        C
+        connect(const std::function<void(const T&, const T&)>& fn)
+        {
+            return signals()._changedSig2.connect(fn);
+        }
+
+        template<class... Args>
+        C
+        connect(const std::function<void(const T&, const T&)>& fn, Args... args)
+        {
+            return signals()._changedSig2.connect(fn, args...);
+        }
+
+        void disconnect_all()
+        {
+            if (_signals)
+            {
+                _signals->_changedSig.disconnect_all();
+                _signals->_changedSig2.disconnect_all();
+            }
+        }
+
+    protected:
+        D* owner()
+        {
+            return reinterpret_cast<D*>(reinterpret_cast<char*>(this) - O());
+        }
+
+        const D* owner() const
+        {
+            return reinterpret_cast<const D*>(reinterpret_cast<const char*>(this) - O());
+        }
+
+    private:
+        lazy_signals<T,S>& signals()
+        {
+            if (!_signals)
+            {
+                _signals.reset(new lazy_signals<T,S>());
+            }
+
+            return *_signals;
+        }
+
+        void send(const T& newVal)
+        {
+            if (_signals)
+            {
+                _signals->_changedSig(newVal);
+            }
+        }
+
+        void send(const T& newVal, const T& oldVal)
+        {
+            if (_signals)
+            {
+                _signals->_changedSig2(newVal, oldVal);
+            }
+        }
+
+        std::unique_ptr<lazy_signals<T,S>> _signals;
+    };
+
+    template<class T, class D, var_return_type V,
+             typename const_return_type<T,V>::type(D::*G)() const,
+             std::size_t(*O)(),
+             template<class> class S, class C>
+    class const_basic_bound_property :
+        public bound_property_base<T, D, V, G, O, S, C>
+    {
+    public:
+        const_basic_bound_property()
+        {
+        }
+
+        const_basic_bound_property(const const_basic_bound_property& other) :
+            bound_property_base<T, D, V, G, O, S, C>(other)
+        {
+        }
+
+    private:
+        const_basic_bound_property<T,D,V,G,O,S,C>&
+        operator=(const T& rhs);
+    };
+
+    template<class T, class D, var_return_type V,
+             typename const_return_type<T,V>::type(D::*G)() const,
+             void(D::*U)(const T&),
+             std::size_t(*O)(),
+             template<class> class S, class C>
+    class basic_bound_property :
+        public bound_property_base<T, D, V, G, O, S, C>
+    {
+    public:
+        basic_bound_property()
+        {
+        }
+
+        basic_bound_property(const basic_bound_property& other) :
+            bound_property_base<T, D, V, G, O, S, C>(other)
+        {
+        }
+
+        basic_bound_property<T,D,V,G,U,O,S,C>&
+        operator=(const T& rhs)
+        {
+            (this->owner()->*U)(rhs);
+
+            return *this;
+        }
+
+    private:
+        basic_bound_property<T,D,V,G,U,O,S,C>&
+        operator=(const basic_bound_property&);
+    };
+
     template<typename T> using property =
         basic_property<T, var_return_type::ref, obj::signal, obj::connection>;
     template<typename T> using ref_property =
         basic_property<T, var_return_type::ref, obj::signal, obj::connection>;
-    
+
+    template<typename T> using lazy_property =
+        basic_lazy_property<T, var_return_type::ref, obj::signal, obj::connection>;
+
     template<typename T> using const_property =
         const_basic_property<T, var_return_type::ref>;
     template<typename T> using const_ref_property =
@@ -443,6 +803,26 @@ namespace obj
         const_basic_dynamic_property<T, D, var_return_type::copy, obj::signal, obj::connection>;
     template<typename T, typename D> using const_dynamic_ref_property =
         const_basic_dynamic_property<T, D, var_return_type::ref, obj::signal, obj::connection>;
+
+    template<typename T, typename D,
+             T(D::*G)() const, void(D::*U)(const T&), std::size_t(*O)()>
+    using bound_property =
+        basic_bound_property<T, D, var_return_type::copy, G, U, O,
+                             obj::signal, obj::connection>;
+    template<typename T, typename D,
+             const T&(D::*G)() const, void(D::*U)(const T&), std::size_t(*O)()>
+    using bound_ref_property =
+        basic_bound_property<T, D, var_return_type::ref, G, U, O,
+                             obj::signal, obj::connection>;
+
+    template<typename T, typename D, T(D::*G)() const, std::size_t(*O)()>
+    using const_bound_property =
+        const_basic_bound_property<T, D, var_return_type::copy, G, O,
+                                   obj::signal, obj::connection>;
+    template<typename T, typename D, const T&(D::*G)() const, std::size_t(*O)()>
+    using const_bound_ref_property =
+        const_basic_bound_property<T, D, var_return_type::ref, G, O,
+                                   obj::signal, obj::connection>;
 }
 
 #ifdef OBJ_ALLOW_SELF
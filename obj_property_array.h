@@ -0,0 +1,301 @@
+//
+// obj_property_array.h
+// Passageways
+//
+// Copyright (c) 2014 Vincent Tourangeau.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+#ifndef __OBJ_PROPERTY_ARRAY_H__
+#define __OBJ_PROPERTY_ARRAY_H__
+
+#include <obj_dirty_set.h>
+#include <obj_property.h>
+
+#include <algorithm>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+namespace obj
+{
+    // An observable array of values stored contiguously in Storage, which
+    // must provide size(), data() and operator[] (std::vector by default).
+    //
+    // Writes only record which indices changed. Nothing is sent until
+    // notify(), which delivers the changed indices once to whole-array
+    // listeners, once per overlapping range to range listeners, and per
+    // index to index listeners. Bulk passes can write through data() and
+    // report what they touched with mark_changed().
+    //
+    // Index and range signals left without connections are dropped by the
+    // next notify() that comes across them, and by connect() for ranges.
+
+    template<class T, class Storage = std::vector<T>>
+    class property_array
+    {
+    public:
+        using indices = std::vector<std::size_t>;
+
+        property_array(std::size_t size = 0, const T& val = T()) :
+            _depth(0),
+            _dirty(size),
+            _staleRanges(false),
+            _values(size, val)
+        {
+        }
+
+        explicit property_array(Storage&& values) :
+            _depth(0),
+            _dirty(values.size()),
+            _staleRanges(false),
+            _values(std::move(values))
+        {
+        }
+
+        std::size_t size() const
+        {
+            return _values.size();
+        }
+
+        const T& operator[](std::size_t idx) const
+        {
+            return _values[idx];
+        }
+
+        const T& get(std::size_t idx) const
+        {
+            return _values[idx];
+        }
+
+        void set(std::size_t idx, const T& val)
+        {
+            if (!compare<T>::equal(_values[idx], val))
+            {
+                _values[idx] = val;
+                _dirty.insert(idx);
+            }
+        }
+
+        T* data()
+        {
+            return _values.data();
+        }
+
+        const T* data() const
+        {
+            return _values.data();
+        }
+
+        void mark_changed(std::size_t idx)
+        {
+            _dirty.insert(idx);
+        }
+
+        void mark_changed(std::size_t first, std::size_t last)
+        {
+            _dirty.insert(first, last);
+        }
+
+        bool changed(std::size_t idx) const
+        {
+            return _dirty.contains(idx);
+        }
+
+        const indices& changes() const
+        {
+            return _dirty.indices();
+        }
+
+        connection
+        connect(const std::function<void(const indices&)>& fn)
+        {
+            return _changedSig.connect(fn);
+        }
+
+        connection
+        connect(std::size_t idx, const std::function<void(std::size_t, const T&)>& fn)
+        {
+            return _indexSigs[idx].connect(fn);
+        }
+
+        connection
+        connect(std::size_t first, std::size_t last,
+                const std::function<void(const indices&)>& fn)
+        {
+            if (_depth == 0)
+            {
+                prune_ranges();
+            }
+
+            _rangeSigs.emplace_back(new range_signal(first, last));
+
+            return _rangeSigs.back()->_sig.connect(fn);
+        }
+
+        void notify()
+        {
+            depth_guard guard(*this);
+
+            _dirty.drain(
+            [this](const indices& changed)
+            {
+                _changedSig(changed);
+
+                if (!_indexSigs.empty())
+                {
+                    for (auto idx : changed)
+                    {
+                        auto it = _indexSigs.find(idx);
+
+                        if (it == _indexSigs.end())
+                        {
+                            continue;
+                        }
+
+                        if (it->second.connected())
+                        {
+                            it->second(idx, _values[idx]);
+                        }
+                        else
+                        {
+                            _staleIndices.push_back(idx);
+                        }
+                    }
+                }
+
+                indices inRange;
+
+                // Listeners may connect more ranges, so walk by index.
+                for (std::size_t i = 0; i < _rangeSigs.size(); ++i)
+                {
+                    range_signal* range = _rangeSigs[i].get();
+
+                    if (!range->_sig.connected())
+                    {
+                        _staleRanges = true;
+                        continue;
+                    }
+
+                    inRange.clear();
+
+                    for (auto idx : changed)
+                    {
+                        if (idx >= range->_first && idx < range->_last)
+                        {
+                            inRange.push_back(idx);
+                        }
+                    }
+
+                    if (!inRange.empty())
+                    {
+                        range->_sig(inRange);
+                    }
+                }
+            });
+        }
+
+    private:
+        // Tracks notify() nesting, including when a listener throws.
+        // Entries are only erased once no notify() is walking them.
+        class depth_guard
+        {
+        public:
+            depth_guard(property_array& owner) :
+                _owner(owner)
+            {
+                ++_owner._depth;
+            }
+
+            ~depth_guard()
+            {
+                if (--_owner._depth == 0)
+                {
+                    _owner.prune_indices();
+
+                    if (_owner._staleRanges)
+                    {
+                        _owner.prune_ranges();
+                    }
+                }
+            }
+
+        private:
+            depth_guard(const depth_guard&);
+
+            property_array& _owner;
+        };
+
+        struct range_signal
+        {
+            range_signal(std::size_t first, std::size_t last) :
+                _first(first),
+                _last(last)
+            {
+            }
+
+            std::size_t                     _first;
+            std::size_t                     _last;
+            signal<void(const indices&)>    _sig;
+        };
+
+        property_array(const property_array&);
+
+        void prune_indices()
+        {
+            for (auto idx : _staleIndices)
+            {
+                auto it = _indexSigs.find(idx);
+
+                if (it != _indexSigs.end() && !it->second.connected())
+                {
+                    _indexSigs.erase(it);
+                }
+            }
+
+            _staleIndices.clear();
+        }
+
+        void prune_ranges()
+        {
+            _rangeSigs.erase(
+                std::remove_if(_rangeSigs.begin(), _rangeSigs.end(),
+                [](const std::unique_ptr<range_signal>& range)
+                {
+                    return !range->_sig.connected();
+                }),
+                _rangeSigs.end());
+
+            _staleRanges = false;
+        }
+
+        signal<void(const indices&)>                _changedSig;
+        int                                         _depth;
+        dirty_set                                   _dirty;
+        std::unordered_map<std::size_t,
+            signal<void(std::size_t, const T&)>>    _indexSigs;
+        std::vector<std::unique_ptr<range_signal>>  _rangeSigs;
+        bool                                        _staleRanges;
+        indices                                     _staleIndices;
+        Storage                                     _values;
+    };
+}
+
+#endif
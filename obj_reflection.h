@@ -0,0 +1,485 @@
+//
+// obj_reflection.h
+// Passageways
+//
+// Copyright (c) 2014 Vincent Tourangeau.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+#ifndef __OBJ_REFLECTION_H__
+#define __OBJ_REFLECTION_H__
+
+#include <obj_property.h>
+
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <typeinfo>
+#include <vector>
+
+namespace obj
+{
+    // value serialization
+    //
+    // Trivially copyable values are stored as raw bytes. Other types need a
+    // specialization, the same way compare<T> is specialized.
+
+    template<typename T>
+    struct serializer
+    {
+        static_assert(std::is_trivially_copyable<T>::value,
+                      "obj::serializer needs a specialization for this type");
+
+        static void write(std::vector<char>& out, const T& val)
+        {
+            const char* bytes = reinterpret_cast<const char*>(&val);
+            out.insert(out.end(), bytes, bytes + sizeof(T));
+        }
+
+        static bool read(const char*& in, const char* end, T& val)
+        {
+            if (end - in < static_cast<std::ptrdiff_t>(sizeof(T)))
+            {
+                return false;
+            }
+
+            std::memcpy(&val, in, sizeof(T));
+            in += sizeof(T);
+
+            return true;
+        }
+    };
+
+    template<>
+    struct serializer<std::string>
+    {
+        static void write(std::vector<char>& out, const std::string& val)
+        {
+            serializer<std::uint32_t>::write(out, static_cast<std::uint32_t>(val.size()));
+            out.insert(out.end(), val.begin(), val.end());
+        }
+
+        static bool read(const char*& in, const char* end, std::string& val)
+        {
+            std::uint32_t size = 0;
+
+            if (!serializer<std::uint32_t>::read(in, end, size) ||
+                end - in < static_cast<std::ptrdiff_t>(size))
+            {
+                return false;
+            }
+
+            val.assign(in, size);
+            in += size;
+
+            return true;
+        }
+    };
+
+    // reflection
+    //
+    // A class opts in with a static reflect() function that lists its
+    // properties:
+    //
+    //     static void reflect(obj::reflection<Foo>& r)
+    //     {
+    //         r.add("x", &Foo::x);
+    //         r.add_object("child", &Foo::child);
+    //     }
+
+    template<class D>
+    class reflection
+    {
+    public:
+        class field
+        {
+        public:
+            field(const std::string& name, const std::type_info& type,
+                  std::size_t offset) :
+                _name(name),
+                _offset(offset),
+                _type(&type)
+            {
+            }
+
+            virtual ~field() {}
+
+            const std::string& name() const
+            {
+                return _name;
+            }
+
+            std::size_t offset() const
+            {
+                return _offset;
+            }
+
+            const std::type_info& type() const
+            {
+                return *_type;
+            }
+
+            virtual void write(std::vector<char>& out, const D& obj) const = 0;
+            virtual bool read(const char*& in, const char* end, D& obj) const = 0;
+
+        private:
+            std::string             _name;
+            std::size_t             _offset;
+            const std::type_info*   _type;
+        };
+
+        static const reflection<D>& get()
+        {
+            static const reflection<D> instance;
+
+            return instance;
+        }
+
+        template<class P>
+        reflection<D>& add(const std::string& name, P D::*member)
+        {
+            _fields.emplace_back(new property_field<P>(name, member));
+
+            return *this;
+        }
+
+        template<class M>
+        reflection<D>& add_object(const std::string& name, M D::*member)
+        {
+            _fields.emplace_back(new object_field<M>(name, member));
+
+            return *this;
+        }
+
+        const field* find(const std::string& name) const
+        {
+            for (const auto& f : _fields)
+            {
+                if (f->name() == name)
+                {
+                    return f.get();
+                }
+            }
+
+            return nullptr;
+        }
+
+        const field& operator[](std::size_t idx) const
+        {
+            return *_fields[idx];
+        }
+
+        std::size_t size() const
+        {
+            return _fields.size();
+        }
+
+    private:
+        template<class P>
+        class property_field : public field
+        {
+        public:
+            using value_type =
+                typename std::decay<decltype(std::declval<const P&>()())>::type;
+
+            property_field(const std::string& name, P D::*member) :
+                field(name, typeid(value_type), member_offset(member)),
+                _member(member)
+            {
+            }
+
+            void write(std::vector<char>& out, const D& obj) const
+            {
+                serializer<value_type>::write(out, (obj.*_member)());
+            }
+
+            bool read(const char*& in, const char* end, D& obj) const
+            {
+                value_type val;
+
+                if (!serializer<value_type>::read(in, end, val))
+                {
+                    return false;
+                }
+
+                obj.*_member = val;
+
+                return true;
+            }
+
+        private:
+            P D::*_member;
+        };
+
+        template<class M>
+        class object_field : public field
+        {
+        public:
+            object_field(const std::string& name, M D::*member) :
+                field(name, typeid(M), member_offset(member)),
+                _member(member)
+            {
+            }
+
+            void write(std::vector<char>& out, const D& obj) const
+            {
+                reflection<M>::get().write(out, obj.*_member);
+            }
+
+            bool read(const char*& in, const char* end, D& obj) const
+            {
+                return reflection<M>::get().read(in, end, obj.*_member);
+            }
+
+        private:
+            M D::*_member;
+        };
+
+        template<class M> friend class reflection;
+        friend class snapshot_writer;
+        friend class snapshot_reader;
+        friend class delta_writer;
+
+        reflection()
+        {
+            D::reflect(*this);
+
+            assert(_fields.size() < UINT16_MAX);
+        }
+
+        reflection(const reflection&);
+
+        // A record is the field count followed by the fields. A full record
+        // stores the fields in order; a partial one prefixes each with its
+        // index.
+
+        void write(std::vector<char>& out, const D& obj) const
+        {
+            serializer<std::uint16_t>::write(out, static_cast<std::uint16_t>(_fields.size()));
+
+            for (const auto& f : _fields)
+            {
+                f->write(out, obj);
+            }
+        }
+
+        bool read(const char*& in, const char* end, D& obj) const
+        {
+            std::uint16_t count = 0;
+
+            if (!serializer<std::uint16_t>::read(in, end, count) ||
+                count > _fields.size())
+            {
+                return false;
+            }
+
+            bool full = count == _fields.size();
+
+            for (std::uint16_t i = 0; i < count; ++i)
+            {
+                std::uint16_t idx = i;
+
+                if (!full && (!serializer<std::uint16_t>::read(in, end, idx) ||
+                              idx >= _fields.size()))
+                {
+                    return false;
+                }
+
+                if (!_fields[idx]->read(in, end, obj))
+                {
+                    return false;
+                }
+            }
+
+            return true;
+        }
+
+        std::vector<std::unique_ptr<field>> _fields;
+    };
+
+    // snapshots
+    //
+    // A snapshot is the records of a sequence of objects, restored in the
+    // same order they were written.
+
+    class snapshot_writer
+    {
+    public:
+        template<class D>
+        void write(const D& obj)
+        {
+            reflection<D>::get().write(_data, obj);
+        }
+
+        void clear()
+        {
+            _data.clear();
+        }
+
+        const std::vector<char>& data() const
+        {
+            return _data;
+        }
+
+    private:
+        std::vector<char>   _data;
+    };
+
+    class snapshot_reader
+    {
+    public:
+        snapshot_reader(const char* data, std::size_t size) :
+            _pos(data),
+            _end(data + size),
+            _good(true)
+        {
+        }
+
+        snapshot_reader(const std::vector<char>& data) :
+            snapshot_reader(data.data(), data.size())
+        {
+        }
+
+        template<class D>
+        bool read(D& obj)
+        {
+            _good = _good && reflection<D>::get().read(_pos, _end, obj);
+
+            return _good;
+        }
+
+        bool good() const
+        {
+            return _good;
+        }
+
+        bool done() const
+        {
+            return _pos == _end;
+        }
+
+    private:
+        const char* _pos;
+        const char* _end;
+        bool        _good;
+    };
+
+    // Writes only the fields that changed since the previous pass. Objects
+    // must be written in the same order on every pass; the first pass, and
+    // any object not seen before, is written in full. The output is read
+    // back with snapshot_reader, applied on top of the previous state.
+
+    class delta_writer
+    {
+    public:
+        delta_writer() :
+            _cursor(0)
+        {
+        }
+
+        void begin()
+        {
+            _data.clear();
+            _cursor = 0;
+        }
+
+        template<class D>
+        void write(const D& obj)
+        {
+            const reflection<D>& refl = reflection<D>::get();
+
+            if (_cursor == _baselines.size())
+            {
+                _baselines.push_back(baseline());
+            }
+
+            baseline& base = _baselines[_cursor++];
+
+            _current.clear();
+            _ends.clear();
+
+            for (std::size_t i = 0; i < refl.size(); ++i)
+            {
+                refl[i].write(_current, obj);
+                _ends.push_back(_current.size());
+            }
+
+            bool full = base._ends.size() != refl.size();
+
+            _changed.clear();
+
+            for (std::size_t i = 0; i < refl.size() && !full; ++i)
+            {
+                std::size_t start = i ? _ends[i - 1] : 0;
+                std::size_t baseStart = i ? base._ends[i - 1] : 0;
+                std::size_t len = _ends[i] - start;
+
+                if (len != base._ends[i] - baseStart ||
+                    std::memcmp(&_current[start], &base._data[baseStart], len) != 0)
+                {
+                    _changed.push_back(i);
+                }
+            }
+
+            if (full || _changed.size() == refl.size())
+            {
+                serializer<std::uint16_t>::write(_data, static_cast<std::uint16_t>(refl.size()));
+                _data.insert(_data.end(), _current.begin(), _current.end());
+            }
+            else
+            {
+                serializer<std::uint16_t>::write(_data, static_cast<std::uint16_t>(_changed.size()));
+
+                for (auto i : _changed)
+                {
+                    std::size_t start = i ? _ends[i - 1] : 0;
+
+                    serializer<std::uint16_t>::write(_data, static_cast<std::uint16_t>(i));
+                    _data.insert(_data.end(), _current.begin() + start, _current.begin() + _ends[i]);
+                }
+            }
+
+            base._data.swap(_current);
+            base._ends.swap(_ends);
+        }
+
+        const std::vector<char>& data() const
+        {
+            return _data;
+        }
+
+    private:
+        struct baseline
+        {
+            std::vector<char>           _data;
+            std::vector<std::size_t>    _ends;
+        };
+
+        std::vector<baseline>       _baselines;
+        std::vector<std::size_t>    _changed;
+        std::vector<char>           _current;
+        std::size_t                 _cursor;
+        std::vector<char>           _data;
+        std::vector<std::size_t>    _ends;
+    };
+}
+
+#endif
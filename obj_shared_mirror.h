@@ -0,0 +1,608 @@
+//
+// obj_shared_mirror.h
+// Passageways
+//
+// Copyright (c) 2015 Vincent Tourangeau.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+#ifndef __OBJ_SHARED_MIRROR_H__
+#define __OBJ_SHARED_MIRROR_H__
+
+#include <obj_property.h>
+#include <obj_reflection.h>
+
+#include <assert.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <new>
+#include <string>
+#include <vector>
+
+namespace obj
+{
+    // Property mirroring over POSIX shared memory
+    //
+    // A shared_mirror_publisher copies properties into numbered slots of a
+    // named shared memory segment whenever they change. A
+    // shared_mirror_reader in another process maps the segment read-only
+    // and exposes the slots it is interested in as read-only properties,
+    // refreshed by poll(). Neither side makes a system call per change.
+    //
+    //     // publisher
+    //     obj::shared_mirror_publisher mirror("/myservice", 64, 256);
+    //     mirror.publish(0, status);
+    //
+    //     // reader
+    //     obj::shared_mirror_reader mirror("/myservice");
+    //     auto& status = mirror.mirror<std::string>(0);
+    //     status.connect(onStatus);
+    //     ...
+    //     mirror.poll();
+    //
+    // Values are encoded with obj::serializer and must fit in a slot. Each
+    // slot is a seqlock: readers copy it and retry if a write overlapped.
+    // Each write also appends the slot number to a ring, so poll() only
+    // looks at slots that changed, unless it fell more than a ring behind,
+    // in which case it checks them all. There must be a single publisher,
+    // changing its properties from one thread at a time.
+    //
+    // A published value that does not fit its slot is dropped, leaving the
+    // slot at its last value; the publisher counts these and debug builds
+    // assert. A reader gives up on a slot that stays mid-write, say because
+    // the publisher died, after a few attempts and tries it again at the
+    // next poll().
+
+    namespace details
+    {
+        struct mirror_header
+        {
+            std::uint32_t               _magic;
+            std::uint32_t               _slots;
+            std::uint32_t               _slotSize;
+            std::uint32_t               _ringSize;
+            std::atomic<std::uint64_t>  _head;
+        };
+
+        struct mirror_slot
+        {
+            std::atomic<std::uint32_t>  _seq;
+            std::uint32_t               _size;
+        };
+
+        static const std::uint32_t mirror_magic = 0x6f626a73;
+        static const unsigned mirror_retries = 64;
+        static const std::size_t mirror_align = 64;
+
+        inline std::size_t mirror_stride(std::size_t slotSize)
+        {
+            return (sizeof(mirror_slot) + slotSize + mirror_align - 1) / mirror_align * mirror_align;
+        }
+
+        inline std::size_t mirror_bytes(std::size_t slots, std::size_t slotSize, std::size_t ringSize)
+        {
+            return mirror_align + slots * mirror_stride(slotSize) +
+                ringSize * sizeof(std::atomic<std::uint32_t>);
+        }
+
+        // A view of a mapped segment: the header, slot i and the ring.
+        class mirror_layout
+        {
+        public:
+            mirror_layout() :
+                _base(nullptr),
+                _stride(0)
+            {
+            }
+
+            mirror_layout(char* base) :
+                _base(base),
+                _stride(mirror_stride(header()._slotSize))
+            {
+            }
+
+            mirror_header& header() const
+            {
+                return *reinterpret_cast<mirror_header*>(_base);
+            }
+
+            mirror_slot& slot(std::size_t idx) const
+            {
+                return *reinterpret_cast<mirror_slot*>(_base + mirror_align + idx * _stride);
+            }
+
+            char* slot_data(std::size_t idx) const
+            {
+                return reinterpret_cast<char*>(&slot(idx) + 1);
+            }
+
+            std::atomic<std::uint32_t>& ring(std::uint64_t pos) const
+            {
+                auto ring = reinterpret_cast<std::atomic<std::uint32_t>*>(
+                    _base + mirror_align + header()._slots * _stride);
+
+                return ring[pos % header()._ringSize];
+            }
+
+        private:
+            char*       _base;
+            std::size_t _stride;
+        };
+    }
+
+    class shared_mirror_publisher
+    {
+    public:
+        // Creates, or recreates, the segment called name (see shm_open).
+        shared_mirror_publisher(const std::string& name, std::size_t slots,
+                                std::size_t slotSize, std::size_t ringSize = 1024) :
+            _base(nullptr),
+            _bytes(details::mirror_bytes(slots, slotSize, ringSize)),
+            _disconnects(),
+            _dropped(0),
+            _layout(),
+            _name(name),
+            _scratch()
+        {
+            assert(slots > 0 && ringSize > 0);
+
+            ::shm_unlink(name.c_str());
+
+            int fd = ::shm_open(name.c_str(), O_RDWR | O_CREAT | O_EXCL, 0644);
+
+            if (fd < 0)
+            {
+                return;
+            }
+
+            if (::ftruncate(fd, static_cast<off_t>(_bytes)) == 0)
+            {
+                void* base = ::mmap(nullptr, _bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+
+                if (base != MAP_FAILED)
+                {
+                    _base = static_cast<char*>(base);
+                }
+            }
+
+            ::close(fd);
+
+            if (!_base)
+            {
+                ::shm_unlink(name.c_str());
+                return;
+            }
+
+            details::mirror_header* h = new (_base) details::mirror_header();
+
+            h->_slots = static_cast<std::uint32_t>(slots);
+            h->_slotSize = static_cast<std::uint32_t>(slotSize);
+            h->_ringSize = static_cast<std::uint32_t>(ringSize);
+            h->_head.store(0, std::memory_order_relaxed);
+
+            _layout = details::mirror_layout(_base);
+
+            for (std::size_t i = 0; i < slots; ++i)
+            {
+                new (&_layout.slot(i)) details::mirror_slot();
+                _layout.slot(i)._seq.store(0, std::memory_order_relaxed);
+            }
+
+            // Readers check the magic last, once the rest is in place.
+            std::atomic_thread_fence(std::memory_order_release);
+            h->_magic = details::mirror_magic;
+        }
+
+        // Stops publishing and removes the segment name; readers that have
+        // it mapped keep the last values.
+        ~shared_mirror_publisher()
+        {
+            for (const auto& disconnect : _disconnects)
+            {
+                disconnect();
+            }
+
+            if (_base)
+            {
+                ::munmap(_base, _bytes);
+                ::shm_unlink(_name.c_str());
+            }
+        }
+
+        bool is_open() const
+        {
+            return _base != nullptr;
+        }
+
+        // The number of values dropped because they did not fit their slot.
+        std::size_t dropped() const
+        {
+            return _dropped;
+        }
+
+        // Writes the property's value to slot now and on every change until
+        // the publisher is destroyed. Any property type will do.
+        template<typename P, typename T = typename property_value<P>::type>
+        auto publish(std::size_t slot, P& prop) -> decltype(prop.connect(std::function<void(const T&)>()))
+        {
+            bool written = write(slot, prop());
+
+            assert(written || !_base);
+            (void)written;
+
+            auto result = prop.connect(std::function<void(const T&)>(
+            [this, slot](const T& val)
+            {
+                bool written = write(slot, val);
+
+                assert(written || !_base);
+                (void)written;
+            }));
+
+            _disconnects.push_back([result]() { result.disconnect(); });
+
+            return result;
+        }
+
+        // Returns false if the encoded value does not fit in the slot.
+        template<typename T>
+        bool write(std::size_t slot, const T& val)
+        {
+            if (!_base)
+            {
+                return false;
+            }
+
+            details::mirror_header& h = _layout.header();
+
+            assert(slot < h._slots);
+
+            _scratch.clear();
+            serializer<T>::write(_scratch, val);
+
+            if (_scratch.size() > h._slotSize)
+            {
+                ++_dropped;
+                return false;
+            }
+
+            details::mirror_slot& s = _layout.slot(slot);
+            std::uint32_t seq = s._seq.load(std::memory_order_relaxed);
+
+            s._seq.store(seq + 1, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_release);
+
+            s._size = static_cast<std::uint32_t>(_scratch.size());
+            std::memcpy(_layout.slot_data(slot), _scratch.data(), _scratch.size());
+
+            s._seq.store(seq + 2, std::memory_order_release);
+
+            std::uint64_t head = h._head.load(std::memory_order_relaxed);
+
+            _layout.ring(head).store(static_cast<std::uint32_t>(slot), std::memory_order_relaxed);
+            h._head.store(head + 1, std::memory_order_release);
+
+            return true;
+        }
+
+    private:
+        shared_mirror_publisher(const shared_mirror_publisher&);
+
+        char*                               _base;
+        std::size_t                         _bytes;
+        std::vector<std::function<void()>>  _disconnects;
+        std::size_t                         _dropped;
+        details::mirror_layout              _layout;
+        std::string                         _name;
+        std::vector<char>                   _scratch;
+    };
+
+    class shared_mirror_reader;
+
+    // A read-only property updated by a shared_mirror_reader.
+    template<typename T>
+    class mirrored_property : public basic_property_base<T, var_return_type::copy>,
+                              public dynamic_signaller<T, shared_mirror_reader, signal, connection>
+    {
+        friend class shared_mirror_reader;
+
+    public:
+        mirrored_property() :
+            basic_property_base<T, var_return_type::copy>()
+        {
+        }
+
+    private:
+        mirrored_property(const mirrored_property&);
+
+        mirrored_property& operator=(const T& rhs);
+    };
+
+    class shared_mirror_reader
+    {
+    public:
+        shared_mirror_reader(const std::string& name) :
+            _base(nullptr),
+            _bytes(0),
+            _cursor(0),
+            _deferred(),
+            _layout(),
+            _mirrors(),
+            _scratch(),
+            _synced(false)
+        {
+            int fd = ::shm_open(name.c_str(), O_RDONLY, 0);
+
+            if (fd < 0)
+            {
+                return;
+            }
+
+            struct stat st;
+
+            if (::fstat(fd, &st) == 0 && static_cast<std::size_t>(st.st_size) >= sizeof(details::mirror_header))
+            {
+                void* base = ::mmap(nullptr, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+
+                if (base != MAP_FAILED)
+                {
+                    _base = static_cast<char*>(base);
+                    _bytes = static_cast<std::size_t>(st.st_size);
+                }
+            }
+
+            ::close(fd);
+
+            if (_base)
+            {
+                const details::mirror_header* h = reinterpret_cast<const details::mirror_header*>(_base);
+
+                bool valid = h->_magic == details::mirror_magic;
+
+                std::atomic_thread_fence(std::memory_order_acquire);
+
+                if (!valid || details::mirror_bytes(h->_slots, h->_slotSize, h->_ringSize) > _bytes)
+                {
+                    ::munmap(_base, _bytes);
+                    _base = nullptr;
+                    return;
+                }
+
+                _layout = details::mirror_layout(_base);
+                _mirrors.resize(h->_slots);
+                _scratch.resize(h->_slotSize);
+            }
+        }
+
+        ~shared_mirror_reader()
+        {
+            if (_base)
+            {
+                ::munmap(_base, _bytes);
+            }
+        }
+
+        bool is_open() const
+        {
+            return _base != nullptr;
+        }
+
+        // The property mirroring slot, created on first use and filled in
+        // by the next poll(). It can be connected to but not assigned.
+        template<typename T>
+        mirrored_property<T>& mirror(std::size_t slot)
+        {
+            assert(is_open() && slot < _mirrors.size());
+
+            if (!_mirrors[slot])
+            {
+                _mirrors[slot].reset(new mirror_entry<T>());
+                _synced = false;
+            }
+
+            assert(dynamic_cast<mirror_entry<T>*>(_mirrors[slot].get()));
+
+            return static_cast<mirror_entry<T>&>(*_mirrors[slot])._prop;
+        }
+
+        // Applies the changes published since the last poll, firing the
+        // change signals of the mirrored properties that changed. Returns
+        // the number of properties updated.
+        std::size_t poll()
+        {
+            if (!_base)
+            {
+                return 0;
+            }
+
+            std::uint64_t head = _layout.header()._head.load(std::memory_order_acquire);
+            std::size_t ringSize = _layout.header()._ringSize;
+            std::size_t updated = 0;
+
+            std::vector<std::size_t> deferred;
+            deferred.swap(_deferred);
+
+            for (auto slot : deferred)
+            {
+                updated += refresh(slot);
+            }
+
+            if (!_synced || head - _cursor > ringSize)
+            {
+                for (std::size_t i = 0; i < _mirrors.size(); ++i)
+                {
+                    updated += refresh(i);
+                }
+
+                _synced = true;
+            }
+            else
+            {
+                for (std::uint64_t pos = _cursor; pos < head; ++pos)
+                {
+                    std::size_t slot = _layout.ring(pos).load(std::memory_order_relaxed);
+
+                    if (slot < _mirrors.size())
+                    {
+                        updated += refresh(slot);
+                    }
+                }
+
+                // The entries read may have been overwritten meanwhile.
+                if (_layout.header()._head.load(std::memory_order_acquire) - _cursor > ringSize)
+                {
+                    for (std::size_t i = 0; i < _mirrors.size(); ++i)
+                    {
+                        updated += refresh(i);
+                    }
+                }
+            }
+
+            _cursor = head;
+
+            return updated;
+        }
+
+    private:
+        struct mirror_entry_base
+        {
+            mirror_entry_base() :
+                _seq(0)
+            {
+            }
+
+            virtual ~mirror_entry_base() {}
+
+            virtual bool apply(const char* data, std::size_t size) = 0;
+
+            std::uint32_t   _seq;
+        };
+
+        template<typename T>
+        struct mirror_entry : public mirror_entry_base
+        {
+            bool apply(const char* data, std::size_t size)
+            {
+                return shared_mirror_reader::assign(_prop, data, size);
+            }
+
+            mirrored_property<T>    _prop;
+        };
+
+        shared_mirror_reader(const shared_mirror_reader&);
+
+        template<typename T>
+        static bool assign(mirrored_property<T>& prop, const char* data, std::size_t size)
+        {
+            T val;
+
+            if (!serializer<T>::read(data, data + size, val) || compare<T>::equal(prop._val, val))
+            {
+                return false;
+            }
+
+            T oldVal(std::move(prop._val));
+
+            prop._val = std::move(val);
+            prop.send(prop._val);
+            prop.send(prop._val, oldVal);
+
+            return true;
+        }
+
+        // Copies the slot under its seqlock, retrying while a write
+        // overlaps, and applies it if it changed since last seen. A slot
+        // still mid-write after mirror_retries attempts is deferred to the
+        // next poll.
+        std::size_t refresh(std::size_t slot)
+        {
+            mirror_entry_base* entry = _mirrors[slot].get();
+
+            if (!entry)
+            {
+                return 0;
+            }
+
+            const details::mirror_slot& s = _layout.slot(slot);
+            std::uint32_t seq;
+            std::size_t size;
+
+            for (unsigned attempt = 0; ; ++attempt)
+            {
+                if (attempt == details::mirror_retries)
+                {
+                    if (std::find(_deferred.begin(), _deferred.end(), slot) == _deferred.end())
+                    {
+                        _deferred.push_back(slot);
+                    }
+
+                    return 0;
+                }
+
+                seq = s._seq.load(std::memory_order_acquire);
+
+                if (seq & 1)
+                {
+                    continue;
+                }
+
+                size = std::min<std::size_t>(s._size, _scratch.size());
+                std::memcpy(_scratch.data(), _layout.slot_data(slot), size);
+
+                std::atomic_thread_fence(std::memory_order_acquire);
+
+                if (s._seq.load(std::memory_order_relaxed) == seq)
+                {
+                    break;
+                }
+            }
+
+            if (seq == entry->_seq)
+            {
+                return 0;
+            }
+
+            entry->_seq = seq;
+
+            return seq != 0 && entry->apply(_scratch.data(), size) ? 1 : 0;
+        }
+
+        char*                                           _base;
+        std::size_t                                     _bytes;
+        std::uint64_t                                   _cursor;
+        std::vector<std::size_t>                        _deferred;
+        details::mirror_layout                          _layout;
+        std::vector<std::unique_ptr<mirror_entry_base>> _mirrors;
+        std::vector<char>                               _scratch;
+        bool                                            _synced;
+    };
+}
+
+#endif
@@ -27,12 +27,19 @@
 #ifndef __OBJ_SIGNAL_H__
 #define __OBJ_SIGNAL_H__
 
+#include <obj_span.h>
+#include <obj_trace.h>
+
 #include <assert.h>
 
+#include <exception>
 #include <functional>
 #include <map>
 #include <memory>
 #include <set>
+#include <type_traits>
+#include <utility>
+#include <vector>
 
 namespace obj
 {
@@ -55,6 +62,7 @@ namespace obj
         public:
             
             details(int idx, void* function, signal_base* signal, bool fireOnce) :
+                _blocked(0),
                 _idx(idx),
                 _fireOnce(fireOnce),
                 _function(function),
@@ -63,6 +71,7 @@ namespace obj
             {}
             
             details(const details& rhs) :
+                _blocked(rhs._blocked),
                 _idx(rhs._idx),
                 _fireOnce(rhs._fireOnce),
                 _function(rhs._function),
@@ -70,6 +79,7 @@ namespace obj
                 _valid(rhs._valid)
             {}
             
+            int             _blocked;
             bool            _fireOnce;
             void*           _function;
             int             _idx;
@@ -110,6 +120,37 @@ namespace obj
             }
         }
         
+        // Blocked connections stay in place but are skipped by emissions.
+        // Blocks nest: each block() needs its unblock().
+        void block() const
+        {
+            if (_details)
+            {
+                ++_details->_blocked;
+            }
+        }
+        
+        void unblock() const
+        {
+            if (_details)
+            {
+                assert(_details->_blocked > 0);
+                
+                --_details->_blocked;
+            }
+        }
+        
+        bool blocked() const
+        {
+            return _details ? _details->_blocked > 0 : false;
+        }
+        
+        // Connected and not blocked: whether emissions reach the slot.
+        bool active() const
+        {
+            return _details ? _details->_valid && _details->_blocked == 0 : false;
+        }
+        
         bool operator==(const connection& rhs) const
         {
             return index() == rhs.index();
@@ -153,6 +194,29 @@ namespace obj
     };
     
     
+    class connection_blocker
+    {
+    public:
+        connection_blocker(const connection& cnxn) :
+            _cnxn(cnxn)
+        {
+            _cnxn.block();
+        }
+        
+        ~connection_blocker()
+        {
+            _cnxn.unblock();
+        }
+        
+    private:
+        connection_blocker(const connection_blocker&);
+        
+        connection_blocker& operator=(const connection_blocker&);
+        
+        connection  _cnxn;
+    };
+    
+    
     class observer
     {
         friend class signal_base;
@@ -177,6 +241,26 @@ namespace obj
     };
     
     
+    namespace details
+    {
+        struct no_batch_event
+        {
+        };
+        
+        // Only signals taking a single argument can be emitted in batches.
+        template<typename... ArgTypes>
+        struct batch_event
+        {
+            using type = no_batch_event;
+        };
+        
+        template<typename ArgType>
+        struct batch_event<ArgType>
+        {
+            using type = typename std::decay<ArgType>::type;
+        };
+    }
+    
     template<typename T>
     class signal_common;
     
@@ -185,6 +269,8 @@ namespace obj
     {
     public:
         typedef std::function<ReturnType(ArgTypes...)> slot;
+        typedef typename details::batch_event<ArgTypes...>::type event;
+        typedef std::function<void(span<const event>)> batch_slot;
         
         signal_common() :
             _calling(false),
@@ -319,17 +405,95 @@ namespace obj
     {
         typedef std::function<void(ArgTypes...)>    slot;
         typedef signal_common<void(ArgTypes...)>    base_class;
+        
+        typedef typename base_class::batch_slot     batch_slot;
+        typedef typename base_class::event          event;
+    
+        // Wraps a batch slot so single emissions reach it as batches of
+        // one; emit_batch recognizes it and passes the whole span instead.
+        struct batch_adapter
+        {
+            void operator()(ArgTypes... args) const
+            {
+                event e(args...);
+                
+                _fn(span<const event>(&e, 1));
+            }
+            
+            batch_slot _fn;
+        };
     
     public:
+        // Connects a slot that takes a whole batch of events at once. It
+        // still receives single emissions, as batches of one.
+        connection connect_batch(const batch_slot& fn, bool fireOnce = false)
+        {
+            return base_class::connect(batch_adapter{fn}, fireOnce);
+        }
+        
+        // Delivers every event to one slot before moving to the next: batch
+        // slots get the span in a single call, others get each event in
+        // turn. A fire-once slot is disconnected after its first call.
+        void emit_batch(span<const event> events) const
+        {
+            OBJ_TRACE_SCOPE("signal", this);
+            
+            bool oldCalling = base_class::_calling;
+            
+            base_class::_calling = true;
+            
+            for (const auto& cnxn : base_class::_slots)
+            {
+                if (cnxn.active())
+                {
+                    const slot& fn = cnxn.template function<slot>();
+                    const batch_adapter* batch = fn.template target<batch_adapter>();
+                    
+                    if (batch)
+                    {
+                        batch->_fn(events);
+                        
+                        if (cnxn.fireOnce())
+                        {
+                            cnxn.disconnect();
+                        }
+                    }
+                    else
+                    {
+                        for (const auto& e : events)
+                        {
+                            if (!cnxn.active())
+                            {
+                                break;
+                            }
+                            
+                            fn(e);
+                            
+                            if (cnxn.fireOnce())
+                            {
+                                cnxn.disconnect();
+                            }
+                        }
+                    }
+                }
+            }
+            
+            base_class::_calling = oldCalling;
+            
+            const_cast<signal*>(this)->clean();
+        }
+        
         void operator()(ArgTypes... args) const
         {
+            OBJ_TRACE_SCOPE("signal", this);
+            
             bool oldCalling = base_class::_calling;
             
             base_class::_calling = true;
             
             for (const auto& cnxn : base_class::_slots)
             {
-                if (cnxn.valid())
+                if (cnxn.active())
                 {
                     cnxn.template function<slot>()(args...);
                     
@@ -344,6 +508,112 @@ namespace obj
             
             const_cast<signal*>(this)->clean();
         }
+        
+        // Runs the slots in parallel on a thread_pool and returns once they
+        // have all run, rethrowing the first exception one of them threw.
+        // Below threshold active slots this is a plain serial emission.
+        // Where parallel emission starts to pay depends on what the slots
+        // cost and on the machine; bench/emit_parallel.cpp measures it.
+        // Slots run concurrently: they must be safe to, and must not
+        // connect to or disconnect from this signal.
+        template<typename Pool>
+        void emit_parallel(Pool& pool, std::size_t threshold, ArgTypes... args) const
+        {
+            if (base_class::_slots.size() < threshold)
+            {
+                (*this)(args...);
+                return;
+            }
+            
+            // Each active slot, and whether it has run.
+            std::vector<std::pair<const connection*, bool>> active;
+            
+            for (const auto& cnxn : base_class::_slots)
+            {
+                if (cnxn.active())
+                {
+                    active.push_back(std::make_pair(&cnxn, false));
+                }
+            }
+            
+            if (active.size() < threshold)
+            {
+                (*this)(args...);
+                return;
+            }
+            
+            OBJ_TRACE_SCOPE("signal", this);
+            
+            bool oldCalling = base_class::_calling;
+            
+            base_class::_calling = true;
+            
+            std::exception_ptr error;
+            
+            try
+            {
+                pool.parallel_for(active.size(), 1,
+                [&](std::size_t begin, std::size_t end)
+                {
+                    for (std::size_t i = begin; i < end; ++i)
+                    {
+                        active[i].first->template function<slot>()(args...);
+                        active[i].second = true;
+                    }
+                });
+            }
+            catch (...)
+            {
+                error = std::current_exception();
+            }
+            
+            // As in a serial emission, fire-once slots that ran are
+            // disconnected even when another slot threw.
+            for (const auto& a : active)
+            {
+                if (a.second && a.first->fireOnce())
+                {
+                    a.first->disconnect();
+                }
+            }
+            
+            base_class::_calling = oldCalling;
+            
+            const_cast<signal*>(this)->clean();
+            
+            if (error)
+            {
+                std::rethrow_exception(error);
+            }
+        }
+        
+        // Submits each slot, with copies of the arguments, to a
+        // thread_pool::task_group and returns at once; wait on the group
+        // to join them.
+        template<typename Group>
+        void emit_async(Group& group, ArgTypes... args) const
+        {
+            bool oldCalling = base_class::_calling;
+            
+            base_class::_calling = true;
+            
+            for (const auto& cnxn : base_class::_slots)
+            {
+                if (cnxn.active())
+                {
+                    group.run(std::bind(cnxn.template function<slot>(), args...));
+                    
+                    if (cnxn.fireOnce())
+                    {
+                        cnxn.disconnect();
+                    }
+                }
+            }
+            
+            base_class::_calling = oldCalling;
+            
+            const_cast<signal*>(this)->clean();
+        }
     };
     
     template<typename ReturnType, typename... ArgTypes>
@@ -355,6 +625,8 @@ namespace obj
     public:
         ReturnType operator()(ArgTypes... args) const
         {
+            OBJ_TRACE_SCOPE("signal", this);
+            
             ReturnType result;
             bool oldCalling = base_class::_calling;
             
@@ -362,7 +634,7 @@ namespace obj
             
             for (const auto& cnxn : base_class::_slots)
             {
-                if (cnxn.valid())
+                if (cnxn.active())
                 {
                     result = cnxn.template function<slot>()(args...);
                 }
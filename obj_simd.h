@@ -0,0 +1,370 @@
+//
+//  obj_simd.h
+//  Passageways
+//
+//  Copyright (c) 2015 Vincent Tourangeau. All rights reserved.
+//
+
+#ifndef __OBJ_SIMD_H__
+#define __OBJ_SIMD_H__
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <type_traits>
+
+#if !defined(OBJ_NO_SIMD) && (defined(__GNUC__) || defined(__clang__)) && \
+    (defined(__x86_64__) || defined(__i386__))
+#define OBJ_SIMD_X86 1
+#include <immintrin.h>
+#endif
+
+namespace obj
+{
+    // Vectorized kernels over contiguous arrays, used by obj_algorithm.h
+    // for vectors of integers. On x86 the widest instruction set the CPU
+    // reports at run time is used (AVX2, then SSE4.1); elsewhere, or with
+    // OBJ_NO_SIMD defined, the scalar versions run.
+
+    namespace simd
+    {
+        template<class T>
+        struct is_searchable :
+            std::integral_constant<bool,
+                std::is_integral<T>::value && !std::is_same<T, bool>::value &&
+                (sizeof(T) == 1 || sizeof(T) == 2 || sizeof(T) == 4 || sizeof(T) == 8)>
+        {
+        };
+
+        template<class T>
+        struct is_intersectable :
+            std::integral_constant<bool,
+                std::is_same<T, std::int32_t>::value || std::is_same<T, std::uint32_t>::value>
+        {
+        };
+
+        template<class T>
+        std::size_t find_scalar(const T* data, std::size_t size, T val)
+        {
+            return std::find(data, data + size, val) - data;
+        }
+
+        // Finds val in a sorted range starting from first, doubling the
+        // step until it is passed and then binary searching the last step.
+        template<class RandomIt, class T, class Compare>
+        RandomIt gallop(RandomIt first, RandomIt last, const T& val, Compare comp)
+        {
+            std::size_t step = 1;
+            RandomIt lo = first;
+
+            while (static_cast<std::size_t>(last - first) > step && comp(first[step], val))
+            {
+                lo = first + step;
+                step *= 2;
+            }
+
+            RandomIt hi = static_cast<std::size_t>(last - first) > step ? first + step + 1 : last;
+
+            return std::lower_bound(lo, hi, val, comp);
+        }
+
+        template<class RandomIt, class T>
+        RandomIt gallop(RandomIt first, RandomIt last, const T& val)
+        {
+            return gallop(first, last, val, std::less<T>());
+        }
+
+        template<class T>
+        std::size_t intersect_scalar(const T* a, std::size_t na,
+                                     const T* b, std::size_t nb, T* out)
+        {
+            T* start = out;
+            const T* lastA = a + na;
+            const T* lastB = b + nb;
+
+            while (a != lastA && b != lastB)
+            {
+                if (*a < *b)
+                {
+                    ++a;
+                }
+                else if (*b < *a)
+                {
+                    ++b;
+                }
+                else
+                {
+                    *out++ = *a;
+                    ++a;
+                    ++b;
+                }
+            }
+
+            return out - start;
+        }
+
+        // For a much smaller than b: gallop through b for each value of a.
+        template<class T>
+        std::size_t intersect_galloping(const T* a, std::size_t na,
+                                        const T* b, std::size_t nb, T* out)
+        {
+            T* start = out;
+            const T* lastB = b + nb;
+
+            for (std::size_t i = 0; i < na && b != lastB; ++i)
+            {
+                b = gallop(b, lastB, a[i]);
+
+                if (b != lastB && !(a[i] < *b))
+                {
+                    *out++ = a[i];
+                    ++b;
+                }
+            }
+
+            return out - start;
+        }
+
+#ifdef OBJ_SIMD_X86
+
+        inline bool has_avx2()
+        {
+            static const bool result = __builtin_cpu_supports("avx2");
+
+            return result;
+        }
+
+        inline bool has_sse41()
+        {
+            static const bool result = __builtin_cpu_supports("sse4.1");
+
+            return result;
+        }
+
+        template<class T>
+        __attribute__((target("avx2")))
+        std::size_t find_avx2(const T* data, std::size_t size, T val)
+        {
+            const std::size_t lanes = 32 / sizeof(T);
+
+            __m256i needle;
+
+            switch (sizeof(T))
+            {
+                case 1: needle = _mm256_set1_epi8(static_cast<char>(val)); break;
+                case 2: needle = _mm256_set1_epi16(static_cast<short>(val)); break;
+                case 4: needle = _mm256_set1_epi32(static_cast<int>(val)); break;
+                default: needle = _mm256_set1_epi64x(static_cast<long long>(val)); break;
+            }
+
+            std::size_t i = 0;
+
+            for (; i + lanes <= size; i += lanes)
+            {
+                __m256i block = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + i));
+                __m256i eq;
+
+                switch (sizeof(T))
+                {
+                    case 1: eq = _mm256_cmpeq_epi8(block, needle); break;
+                    case 2: eq = _mm256_cmpeq_epi16(block, needle); break;
+                    case 4: eq = _mm256_cmpeq_epi32(block, needle); break;
+                    default: eq = _mm256_cmpeq_epi64(block, needle); break;
+                }
+
+                unsigned mask = static_cast<unsigned>(_mm256_movemask_epi8(eq));
+
+                if (mask)
+                {
+                    return i + __builtin_ctz(mask) / sizeof(T);
+                }
+            }
+
+            return i + find_scalar(data + i, size - i, val);
+        }
+
+        template<class T>
+        __attribute__((target("sse4.1")))
+        std::size_t find_sse41(const T* data, std::size_t size, T val)
+        {
+            const std::size_t lanes = 16 / sizeof(T);
+
+            __m128i needle;
+
+            switch (sizeof(T))
+            {
+                case 1: needle = _mm_set1_epi8(static_cast<char>(val)); break;
+                case 2: needle = _mm_set1_epi16(static_cast<short>(val)); break;
+                case 4: needle = _mm_set1_epi32(static_cast<int>(val)); break;
+                default: needle = _mm_set1_epi64x(static_cast<long long>(val)); break;
+            }
+
+            std::size_t i = 0;
+
+            for (; i + lanes <= size; i += lanes)
+            {
+                __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i));
+                __m128i eq;
+
+                switch (sizeof(T))
+                {
+                    case 1: eq = _mm_cmpeq_epi8(block, needle); break;
+                    case 2: eq = _mm_cmpeq_epi16(block, needle); break;
+                    case 4: eq = _mm_cmpeq_epi32(block, needle); break;
+                    default: eq = _mm_cmpeq_epi64(block, needle); break;
+                }
+
+                unsigned mask = static_cast<unsigned>(_mm_movemask_epi8(eq));
+
+                if (mask)
+                {
+                    return i + __builtin_ctz(mask) / sizeof(T);
+                }
+            }
+
+            return i + find_scalar(data + i, size - i, val);
+        }
+
+        // Byte shuffles that pack the 32-bit lanes selected by a 4-bit
+        // mask to the front of a register.
+        inline const std::uint8_t* pack_lanes(unsigned mask)
+        {
+            alignas(16) static const std::uint8_t table[16][16] =
+            {
+                { 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80 },
+                { 0, 1, 2, 3, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80 },
+                { 4, 5, 6, 7, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80 },
+                { 0, 1, 2, 3, 4, 5, 6, 7, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80 },
+                { 8, 9, 10, 11, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80 },
+                { 0, 1, 2, 3, 8, 9, 10, 11, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80 },
+                { 4, 5, 6, 7, 8, 9, 10, 11, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80 },
+                { 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 0x80, 0x80, 0x80, 0x80 },
+                { 12, 13, 14, 15, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80 },
+                { 0, 1, 2, 3, 12, 13, 14, 15, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80 },
+                { 4, 5, 6, 7, 12, 13, 14, 15, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80 },
+                { 0, 1, 2, 3, 4, 5, 6, 7, 12, 13, 14, 15, 0x80, 0x80, 0x80, 0x80 },
+                { 8, 9, 10, 11, 12, 13, 14, 15, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80 },
+                { 0, 1, 2, 3, 8, 9, 10, 11, 12, 13, 14, 15, 0x80, 0x80, 0x80, 0x80 },
+                { 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15, 0x80, 0x80, 0x80, 0x80 },
+                { 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15 },
+            };
+
+            return table[mask];
+        }
+
+        // Compares blocks of four values of a against every rotation of a
+        // block of b and packs the matches with one shuffle, then advances
+        // whichever block ends lower. out needs room for three values past
+        // the result, since every block writes a full register.
+        template<class T>
+        __attribute__((target("sse4.1")))
+        std::size_t intersect_sse41(const T* a, std::size_t na,
+                                    const T* b, std::size_t nb, T* out)
+        {
+            std::size_t i = 0;
+            std::size_t j = 0;
+            std::size_t k = 0;
+
+            std::size_t na4 = na & ~std::size_t(3);
+            std::size_t nb4 = nb & ~std::size_t(3);
+
+            while (i < na4 && j < nb4)
+            {
+                __m128i va = _mm_loadu_si128(reinterpret_cast<const __m128i*>(a + i));
+                __m128i vb = _mm_loadu_si128(reinterpret_cast<const __m128i*>(b + j));
+
+                __m128i eq = _mm_cmpeq_epi32(va, vb);
+                eq = _mm_or_si128(eq, _mm_cmpeq_epi32(va, _mm_shuffle_epi32(vb, _MM_SHUFFLE(0, 3, 2, 1))));
+                eq = _mm_or_si128(eq, _mm_cmpeq_epi32(va, _mm_shuffle_epi32(vb, _MM_SHUFFLE(1, 0, 3, 2))));
+                eq = _mm_or_si128(eq, _mm_cmpeq_epi32(va, _mm_shuffle_epi32(vb, _MM_SHUFFLE(2, 1, 0, 3))));
+
+                unsigned mask = static_cast<unsigned>(_mm_movemask_ps(_mm_castsi128_ps(eq)));
+
+                __m128i packed = _mm_shuffle_epi8(va,
+                    _mm_load_si128(reinterpret_cast<const __m128i*>(pack_lanes(mask))));
+
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(out + k), packed);
+
+                k += __builtin_popcount(mask);
+
+                T lastA = a[i + 3];
+                T lastB = b[j + 3];
+
+                if (!(lastB < lastA))
+                {
+                    i += 4;
+                }
+
+                if (!(lastA < lastB))
+                {
+                    j += 4;
+                }
+            }
+
+            return k + intersect_scalar(a + i, na - i, b + j, nb - j, out + k);
+        }
+
+#endif
+
+        template<class T>
+        std::size_t find(const T* data, std::size_t size, T val)
+        {
+            static_assert(is_searchable<T>::value, "obj::simd::find needs an integer type");
+
+#ifdef OBJ_SIMD_X86
+            if (has_avx2())
+            {
+                return find_avx2(data, size, val);
+            }
+
+            if (has_sse41())
+            {
+                return find_sse41(data, size, val);
+            }
+#endif
+
+            return find_scalar(data, size, val);
+        }
+
+        // Padding out needs past the values written by intersect().
+        const std::size_t intersect_padding = 4;
+
+        // Intersects two sorted, duplicate free arrays into out, which needs
+        // room for min(na, nb) + intersect_padding values. Returns the number
+        // of values written.
+        template<class T>
+        std::size_t intersect(const T* a, std::size_t na,
+                              const T* b, std::size_t nb, T* out)
+        {
+            static_assert(is_intersectable<T>::value, "obj::simd::intersect needs 32-bit integers");
+
+            if (na > nb)
+            {
+                std::swap(a, b);
+                std::swap(na, nb);
+            }
+
+            if (na == 0)
+            {
+                return 0;
+            }
+
+            if (nb / na >= 32)
+            {
+                return intersect_galloping(a, na, b, nb, out);
+            }
+
+#ifdef OBJ_SIMD_X86
+            if (has_sse41())
+            {
+                return intersect_sse41(a, na, b, nb, out);
+            }
+#endif
+
+            return intersect_scalar(a, na, b, nb, out);
+        }
+    }
+}
+
+#endif
@@ -0,0 +1,130 @@
+//
+// obj_span.h
+// Passageways
+//
+// Copyright (c) 2015 Vincent Tourangeau.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+#ifndef __OBJ_SPAN_H__
+#define __OBJ_SPAN_H__
+
+#include <assert.h>
+
+#include <cstddef>
+
+namespace obj
+{
+    // A pointer and a length: a view of contiguous elements owned elsewhere.
+
+    template<typename T>
+    class span
+    {
+    public:
+        using value_type = T;
+        using iterator = T*;
+        using const_iterator = T*;
+
+        span() :
+            _data(nullptr),
+            _size(0)
+        {
+        }
+
+        span(T* data, std::size_t size) :
+            _data(data),
+            _size(size)
+        {
+        }
+
+        span(T* first, T* last) :
+            _data(first),
+            _size(last - first)
+        {
+        }
+
+        template<std::size_t N>
+        span(T (&array)[N]) :
+            _data(array),
+            _size(N)
+        {
+        }
+
+        // Any contiguous container: vector, array, string, flat_set...
+        template<typename C>
+        span(C& c, decltype(static_cast<T*>(c.data()))* = nullptr) :
+            _data(c.data()),
+            _size(c.size())
+        {
+        }
+
+        template<typename C>
+        span(const C& c, decltype(static_cast<T*>(c.data()))* = nullptr) :
+            _data(c.data()),
+            _size(c.size())
+        {
+        }
+
+        T* data() const
+        {
+            return _data;
+        }
+
+        std::size_t size() const
+        {
+            return _size;
+        }
+
+        bool empty() const
+        {
+            return _size == 0;
+        }
+
+        T* begin() const
+        {
+            return _data;
+        }
+
+        T* end() const
+        {
+            return _data + _size;
+        }
+
+        T& operator[](std::size_t idx) const
+        {
+            assert(idx < _size);
+
+            return _data[idx];
+        }
+
+        span subspan(std::size_t offset, std::size_t count) const
+        {
+            assert(offset + count <= _size);
+
+            return span(_data + offset, count);
+        }
+
+    private:
+        T*          _data;
+        std::size_t _size;
+    };
+}
+
+#endif
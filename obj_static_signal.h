@@ -0,0 +1,335 @@
+//
+// obj_static_signal.h
+// Passageways
+//
+// Copyright (c) 2015 Vincent Tourangeau.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+#ifndef __OBJ_STATIC_SIGNAL_H__
+#define __OBJ_STATIC_SIGNAL_H__
+
+#include <obj_property.h>
+
+#include <assert.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+namespace obj
+{
+    // static signals
+    //
+    // A signal with room for N slots inside the object itself. Callables are
+    // constructed in place in a fixed buffer per slot, so neither connecting
+    // nor emitting allocates, and an emission visits at most N slots.
+    // Callables larger than the buffer are rejected at compile time; connect
+    // returns an invalid connection once all N slots are taken.
+    //
+    // A std::function can be connected when it fits the buffer, but copying
+    // it may allocate if its own target does not fit inside it; connect
+    // lambdas directly on paths that must not allocate.
+    //
+    // Connections refer to their signal by address: they must not be used
+    // after the signal is destroyed, and static signals cannot be copied.
+
+    class static_signal_base
+    {
+    public:
+        virtual void disconnect(std::size_t idx, std::uint32_t generation) = 0;
+
+        virtual bool connected(std::size_t idx, std::uint32_t generation) const = 0;
+    };
+
+    class static_connection
+    {
+    public:
+        static_connection() :
+            _generation(0),
+            _idx(0),
+            _signal(nullptr)
+        {
+        }
+
+        static_connection(static_signal_base* signal, std::size_t idx, std::uint32_t generation) :
+            _generation(generation),
+            _idx(idx),
+            _signal(signal)
+        {
+        }
+
+        void disconnect() const
+        {
+            if (_signal)
+            {
+                _signal->disconnect(_idx, _generation);
+            }
+        }
+
+        bool valid() const
+        {
+            return _signal && _signal->connected(_idx, _generation);
+        }
+
+        bool operator==(const static_connection& rhs) const
+        {
+            return _signal == rhs._signal && _idx == rhs._idx && _generation == rhs._generation;
+        }
+
+    private:
+        std::uint32_t       _generation;
+        std::size_t         _idx;
+        static_signal_base* _signal;
+    };
+
+    template<typename T, std::size_t N, std::size_t Size = 4 * sizeof(void*)>
+    class static_signal
+    {
+    };
+
+    template<typename... ArgTypes, std::size_t N, std::size_t Size>
+    class static_signal<void(ArgTypes...), N, Size> : public static_signal_base
+    {
+    public:
+        static_signal() :
+            _calling(false),
+            _dirty(false)
+        {
+        }
+
+        ~static_signal()
+        {
+            for (std::size_t i = 0; i < N; ++i)
+            {
+                release(_slots[i]);
+            }
+        }
+
+        template<typename F>
+        static_connection connect(const F& fn, bool fireOnce = false)
+        {
+            using stored = typename std::decay<F>::type;
+
+            static_assert(sizeof(stored) <= Size,
+                          "callable does not fit in a static_signal slot");
+            static_assert(alignof(stored) <= alignof(storage),
+                          "callable is over-aligned for a static_signal slot");
+
+            for (std::size_t i = 0; i < N; ++i)
+            {
+                slot& s = _slots[i];
+
+                if (s._state == slot_state::empty)
+                {
+                    new (&s._storage) stored(fn);
+
+                    s._destroy = &destroy<stored>;
+                    s._fireOnce = fireOnce;
+                    s._invoke = &invoke<stored>;
+                    s._state = slot_state::live;
+
+                    return static_connection(this, i, ++s._generation);
+                }
+            }
+
+            return static_connection();
+        }
+
+        bool connected() const
+        {
+            for (std::size_t i = 0; i < N; ++i)
+            {
+                if (_slots[i]._state == slot_state::live)
+                {
+                    return true;
+                }
+            }
+
+            return false;
+        }
+
+        bool connected(std::size_t idx, std::uint32_t generation) const
+        {
+            assert(idx < N);
+
+            return _slots[idx]._state == slot_state::live && _slots[idx]._generation == generation;
+        }
+
+        void disconnect(std::size_t idx, std::uint32_t generation)
+        {
+            if (connected(idx, generation))
+            {
+                kill(_slots[idx]);
+            }
+        }
+
+        void disconnect(const static_connection& cnxn)
+        {
+            cnxn.disconnect();
+        }
+
+        void disconnect_all()
+        {
+            for (std::size_t i = 0; i < N; ++i)
+            {
+                if (_slots[i]._state == slot_state::live)
+                {
+                    kill(_slots[i]);
+                }
+            }
+        }
+
+        void operator()(ArgTypes... args) const
+        {
+            OBJ_TRACE_SCOPE("signal", this);
+
+            bool oldCalling = _calling;
+
+            _calling = true;
+
+            for (std::size_t i = 0; i < N; ++i)
+            {
+                slot& s = _slots[i];
+
+                if (s._state == slot_state::live)
+                {
+                    s._invoke(&s._storage, args...);
+
+                    if (s._fireOnce && s._state == slot_state::live)
+                    {
+                        const_cast<static_signal*>(this)->kill(s);
+                    }
+                }
+            }
+
+            _calling = oldCalling;
+
+            if (!_calling && _dirty)
+            {
+                const_cast<static_signal*>(this)->clean();
+            }
+        }
+
+    private:
+        using storage = typename std::aligned_storage<Size>::type;
+
+        // Slots disconnected during an emission are only marked dead, since
+        // their callable may be running; they are destroyed and reused once
+        // the outermost emission returns.
+        enum class slot_state : std::uint8_t
+        {
+            empty,
+            live,
+            dead
+        };
+
+        struct slot
+        {
+            slot() :
+                _destroy(nullptr),
+                _fireOnce(false),
+                _generation(0),
+                _invoke(nullptr),
+                _state(slot_state::empty)
+            {
+            }
+
+            void            (*_destroy)(void*);
+            bool            _fireOnce;
+            std::uint32_t   _generation;
+            void            (*_invoke)(void*, ArgTypes...);
+            slot_state      _state;
+            storage         _storage;
+        };
+
+        template<typename F>
+        static void invoke(void* fn, ArgTypes... args)
+        {
+            (*static_cast<F*>(fn))(args...);
+        }
+
+        template<typename F>
+        static void destroy(void* fn)
+        {
+            static_cast<F*>(fn)->~F();
+        }
+
+        static_signal(const static_signal&);
+
+        static_signal& operator=(const static_signal&);
+
+        void kill(slot& s)
+        {
+            if (_calling)
+            {
+                s._state = slot_state::dead;
+                _dirty = true;
+            }
+            else
+            {
+                release(s);
+            }
+        }
+
+        void release(slot& s)
+        {
+            if (s._state != slot_state::empty)
+            {
+                s._destroy(&s._storage);
+                s._state = slot_state::empty;
+            }
+        }
+
+        void clean()
+        {
+            for (std::size_t i = 0; i < N; ++i)
+            {
+                if (_slots[i]._state == slot_state::dead)
+                {
+                    release(_slots[i]);
+                }
+            }
+
+            _dirty = false;
+        }
+
+        mutable bool    _calling;
+        mutable bool    _dirty;
+        mutable slot    _slots[N];
+    };
+
+    // static_signals<N>::type is a one-parameter template for the S
+    // parameter of basic_property and its relatives.
+
+    template<std::size_t N>
+    struct static_signals
+    {
+        template<typename T>
+        using type = static_signal<T, N>;
+    };
+
+    template<typename T, std::size_t N = 4> using static_property =
+        basic_property<T, var_return_type::copy, static_signals<N>::template type, static_connection>;
+}
+
+#endif
@@ -0,0 +1,477 @@
+//
+// obj_thread_pool.h
+// Passageways
+//
+// Copyright (c) 2015 Vincent Tourangeau.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+#ifndef __OBJ_THREAD_POOL_H__
+#define __OBJ_THREAD_POOL_H__
+
+#include <assert.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace obj
+{
+    // A work-stealing thread pool. Each worker owns a queue, runs its own
+    // tasks newest first and steals the oldest task of another worker when
+    // it runs dry. Tasks submitted from a worker go to that worker's queue;
+    // others are spread round robin.
+
+    class thread_pool
+    {
+    public:
+        using task = std::function<void()>;
+
+        class task_group;
+
+        explicit thread_pool(std::size_t threads = std::thread::hardware_concurrency()) :
+            _next(0),
+            _pending(0),
+            _queues(),
+            _stop(false),
+            _threads()
+        {
+            for (std::size_t i = 0; i < threads; ++i)
+            {
+                _queues.emplace_back(new queue());
+            }
+
+            for (std::size_t i = 0; i < threads; ++i)
+            {
+                _threads.emplace_back(&thread_pool::work, this, i);
+            }
+        }
+
+        ~thread_pool()
+        {
+            {
+                std::lock_guard<std::mutex> lock(_mutex);
+                _stop = true;
+            }
+
+            _wake.notify_all();
+
+            for (auto& thread : _threads)
+            {
+                thread.join();
+            }
+        }
+
+        std::size_t size() const
+        {
+            return _threads.size();
+        }
+
+        void submit(task fn)
+        {
+            if (_queues.empty())
+            {
+                fn();
+                return;
+            }
+
+            std::size_t idx = current() == this ? worker_index() :
+                _next.fetch_add(1, std::memory_order_relaxed) % _queues.size();
+
+            {
+                std::lock_guard<std::mutex> lock(_queues[idx]->_mutex);
+                _queues[idx]->_tasks.push_back(std::move(fn));
+            }
+
+            {
+                std::lock_guard<std::mutex> lock(_mutex);
+                ++_pending;
+            }
+
+            _wake.notify_one();
+        }
+
+        // Splits [0, count) into chunks of at least grain indices and calls
+        // fn(begin, end) on each, on the workers and the calling thread.
+        // Returns when every chunk is done. The first exception thrown by
+        // fn cancels the chunks not yet started and is rethrown here.
+        template<class Fn>
+        void parallel_for(std::size_t count, std::size_t grain, Fn fn)
+        {
+            if (count == 0)
+            {
+                return;
+            }
+
+            grain = std::max<std::size_t>(grain, 1);
+
+            std::size_t chunks = (count + grain - 1) / grain;
+
+            if (chunks == 1 || _threads.empty())
+            {
+                fn(std::size_t(0), count);
+                return;
+            }
+
+            auto state = std::make_shared<for_state>(chunks);
+
+            auto run =
+            [state, count, grain, fn]()
+            {
+                std::size_t chunk;
+
+                while ((chunk = state->_next.fetch_add(1)) < state->_chunks)
+                {
+                    if (!state->_cancelled.load(std::memory_order_relaxed))
+                    {
+                        try
+                        {
+                            std::size_t begin = chunk * grain;
+                            fn(begin, std::min(begin + grain, count));
+                        }
+                        catch (...)
+                        {
+                            state->fail(std::current_exception());
+                        }
+                    }
+
+                    state->finish();
+                }
+            };
+
+            std::size_t helpers = std::min(chunks - 1, _threads.size());
+
+            for (std::size_t i = 0; i < helpers; ++i)
+            {
+                submit(run);
+            }
+
+            run();
+
+            state->wait();
+
+            if (state->_error)
+            {
+                std::rethrow_exception(state->_error);
+            }
+        }
+
+        // A grain that gives each thread a few chunks to balance load.
+        std::size_t grain_for(std::size_t count) const
+        {
+            return std::max<std::size_t>(count / ((_threads.size() + 1) * 4), 1);
+        }
+
+    private:
+        friend class task_group;
+
+        struct queue
+        {
+            std::mutex          _mutex;
+            std::deque<task>    _tasks;
+        };
+
+        struct for_state
+        {
+            for_state(std::size_t chunks) :
+                _cancelled(false),
+                _chunks(chunks),
+                _done(0),
+                _error(),
+                _next(0)
+            {
+            }
+
+            void fail(std::exception_ptr error)
+            {
+                std::lock_guard<std::mutex> lock(_mutex);
+
+                if (!_error)
+                {
+                    _error = error;
+                }
+
+                _cancelled = true;
+            }
+
+            void finish()
+            {
+                if (_done.fetch_add(1) + 1 == _chunks)
+                {
+                    std::lock_guard<std::mutex> lock(_mutex);
+                    _finished.notify_all();
+                }
+            }
+
+            void wait()
+            {
+                std::unique_lock<std::mutex> lock(_mutex);
+
+                _finished.wait(lock, [this] { return _done.load() == _chunks; });
+            }
+
+            std::atomic<bool>           _cancelled;
+            std::size_t                 _chunks;
+            std::atomic<std::size_t>    _done;
+            std::exception_ptr          _error;
+            std::condition_variable     _finished;
+            std::mutex                  _mutex;
+            std::atomic<std::size_t>    _next;
+        };
+
+        thread_pool(const thread_pool&);
+
+        static thread_pool*& current()
+        {
+            static thread_local thread_pool* pool = nullptr;
+
+            return pool;
+        }
+
+        static std::size_t& worker_index()
+        {
+            static thread_local std::size_t idx = 0;
+
+            return idx;
+        }
+
+        bool take(std::size_t idx, task& fn)
+        {
+            for (std::size_t i = 0; i < _queues.size(); ++i)
+            {
+                queue& q = *_queues[(idx + i) % _queues.size()];
+
+                std::lock_guard<std::mutex> lock(q._mutex);
+
+                if (!q._tasks.empty())
+                {
+                    if (i == 0)
+                    {
+                        fn = std::move(q._tasks.back());
+                        q._tasks.pop_back();
+                    }
+                    else
+                    {
+                        fn = std::move(q._tasks.front());
+                        q._tasks.pop_front();
+                    }
+
+                    return true;
+                }
+            }
+
+            return false;
+        }
+
+        // Runs one queued task on the calling thread, if there is one, so a
+        // thread waiting on tasks can help instead of blocking on them.
+        bool run_one()
+        {
+            {
+                std::lock_guard<std::mutex> lock(_mutex);
+
+                if (_pending == 0)
+                {
+                    return false;
+                }
+
+                --_pending;
+            }
+
+            task fn;
+            std::size_t idx = current() == this ? worker_index() : 0;
+
+            while (!take(idx, fn))
+            {
+                std::this_thread::yield();
+            }
+
+            fn();
+
+            return true;
+        }
+
+        void work(std::size_t idx)
+        {
+            current() = this;
+            worker_index() = idx;
+
+            for (;;)
+            {
+                {
+                    std::unique_lock<std::mutex> lock(_mutex);
+
+                    _wake.wait(lock, [this] { return _stop || _pending > 0; });
+
+                    if (_pending == 0)
+                    {
+                        return;
+                    }
+
+                    --_pending;
+                }
+
+                // Every pending count has a queued task, but another worker
+                // may have stolen it first; keep looking until one is found.
+                task fn;
+
+                while (!take(idx, fn))
+                {
+                    std::this_thread::yield();
+                }
+
+                fn();
+            }
+        }
+
+        std::atomic<std::size_t>            _next;
+        std::size_t                         _pending;
+        std::vector<std::unique_ptr<queue>> _queues;
+        bool                                _stop;
+        std::vector<std::thread>            _threads;
+        std::mutex                          _mutex;
+        std::condition_variable             _wake;
+    };
+
+    // A set of tasks submitted to a pool that can be waited on together.
+    // wait() runs queued tasks while it waits, so it can be called from a
+    // worker, and rethrows the first exception thrown by a task.
+    class thread_pool::task_group
+    {
+    public:
+        explicit task_group(thread_pool& pool) :
+            _pool(pool),
+            _state(std::make_shared<state>())
+        {
+        }
+
+        ~task_group()
+        {
+            join();
+        }
+
+        void run(task fn)
+        {
+            auto s = _state;
+
+            {
+                std::lock_guard<std::mutex> lock(s->_mutex);
+                ++s->_running;
+            }
+
+            _pool.submit(
+            [s, fn]()
+            {
+                std::exception_ptr error;
+
+                try
+                {
+                    fn();
+                }
+                catch (...)
+                {
+                    error = std::current_exception();
+                }
+
+                std::lock_guard<std::mutex> lock(s->_mutex);
+
+                if (error && !s->_error)
+                {
+                    s->_error = error;
+                }
+
+                if (--s->_running == 0)
+                {
+                    s->_done.notify_all();
+                }
+            });
+        }
+
+        void wait()
+        {
+            join();
+
+            std::exception_ptr error;
+
+            {
+                std::lock_guard<std::mutex> lock(_state->_mutex);
+                std::swap(error, _state->_error);
+            }
+
+            if (error)
+            {
+                std::rethrow_exception(error);
+            }
+        }
+
+    private:
+        struct state
+        {
+            state() :
+                _error(),
+                _running(0)
+            {
+            }
+
+            std::condition_variable _done;
+            std::exception_ptr      _error;
+            std::mutex              _mutex;
+            std::size_t             _running;
+        };
+
+        task_group(const task_group&);
+
+        void join()
+        {
+            for (;;)
+            {
+                {
+                    std::lock_guard<std::mutex> lock(_state->_mutex);
+
+                    if (_state->_running == 0)
+                    {
+                        return;
+                    }
+                }
+
+                if (!_pool.run_one())
+                {
+                    std::unique_lock<std::mutex> lock(_state->_mutex);
+
+                    _state->_done.wait_for(lock, std::chrono::milliseconds(1),
+                    [this] { return _state->_running == 0; });
+                }
+            }
+        }
+
+        thread_pool&            _pool;
+        std::shared_ptr<state>  _state;
+    };
+}
+
+#endif
@@ -0,0 +1,263 @@
+//
+// obj_trace.h
+// Passageways
+//
+// Copyright (c) 2015 Vincent Tourangeau.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+#ifndef __OBJ_TRACE_H__
+#define __OBJ_TRACE_H__
+
+// Tracing of signal emissions and property changes, compiled in only when
+// OBJ_TRACE is defined. Each traced scope records its start, its duration
+// and the scope that was running when it started, so a cascade of changes
+// through connected properties and slots can be reconstructed:
+//
+//     obj::trace::write_json(std::ofstream("cascade.json"));
+//
+// writes the events in the Chrome trace event format, readable by
+// chrome://tracing and Perfetto.
+
+#ifdef OBJ_TRACE
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <iomanip>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <vector>
+
+#ifndef OBJ_TRACE_BUFFER_SIZE
+#define OBJ_TRACE_BUFFER_SIZE 65536
+#endif
+
+#define OBJ_TRACE_SCOPE(name, object) obj::trace::scope _objTraceScope(name, object)
+
+namespace obj
+{
+    namespace trace
+    {
+        struct event
+        {
+            std::uint64_t   _begin;
+            std::uint64_t   _end;
+            std::uint64_t   _id;
+            const char*     _name;
+            const void*     _object;
+            std::uint64_t   _parent;
+        };
+
+        // Written only by its own thread. Events are published by bumping
+        // the count, so the buffer can be exported while it is being
+        // filled; once full, further events are counted and dropped.
+        class buffer
+        {
+        public:
+            buffer(std::size_t thread) :
+                _count(0),
+                _dropped(0),
+                _events(OBJ_TRACE_BUFFER_SIZE),
+                _thread(thread)
+            {
+            }
+
+            void push(const event& e)
+            {
+                std::size_t count = _count.load(std::memory_order_relaxed);
+
+                if (count == _events.size())
+                {
+                    _dropped.fetch_add(1, std::memory_order_relaxed);
+                    return;
+                }
+
+                _events[count] = e;
+                _count.store(count + 1, std::memory_order_release);
+            }
+
+            std::atomic<std::size_t>    _count;
+            std::atomic<std::size_t>    _dropped;
+            std::vector<event>          _events;
+            std::size_t                 _thread;
+        };
+
+        class registry
+        {
+        public:
+            static registry& get()
+            {
+                static registry instance;
+
+                return instance;
+            }
+
+            buffer* add()
+            {
+                std::lock_guard<std::mutex> lock(_mutex);
+
+                _buffers.emplace_back(new buffer(_buffers.size() + 1));
+
+                return _buffers.back().get();
+            }
+
+            template<class Fn>
+            void for_each(Fn fn)
+            {
+                std::lock_guard<std::mutex> lock(_mutex);
+
+                for (const auto& b : _buffers)
+                {
+                    fn(*b);
+                }
+            }
+
+        private:
+            registry() :
+                _buffers(),
+                _mutex()
+            {
+            }
+
+            registry(const registry&);
+
+            std::vector<std::unique_ptr<buffer>>    _buffers;
+            std::mutex                              _mutex;
+        };
+
+        // The calling thread's buffer and the id of its innermost scope.
+        // Buffers belong to the registry and outlive their threads.
+        struct thread_state
+        {
+            thread_state() :
+                _buffer(registry::get().add()),
+                _current(0),
+                _next(0)
+            {
+            }
+
+            static thread_state& get()
+            {
+                static thread_local thread_state state;
+
+                return state;
+            }
+
+            buffer*         _buffer;
+            std::uint64_t   _current;
+            std::uint64_t   _next;
+        };
+
+        inline std::uint64_t now()
+        {
+            return std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::steady_clock::now().time_since_epoch()).count();
+        }
+
+        class scope
+        {
+        public:
+            scope(const char* name, const void* object) :
+                _state(thread_state::get())
+            {
+                // Ids are unique across threads without a shared counter:
+                // the thread's buffer number sits above a per-thread count.
+                _event._id = (std::uint64_t(_state._buffer->_thread) << 40) | ++_state._next;
+                _event._name = name;
+                _event._object = object;
+                _event._parent = _state._current;
+
+                _state._current = _event._id;
+
+                _event._begin = now();
+            }
+
+            ~scope()
+            {
+                _event._end = now();
+
+                _state._current = _event._parent;
+                _state._buffer->push(_event);
+            }
+
+        private:
+            scope(const scope&);
+
+            event           _event;
+            thread_state&   _state;
+        };
+
+        inline void write_json(std::ostream& out)
+        {
+            std::ios::fmtflags flags = out.flags();
+            std::streamsize precision = out.precision();
+
+            // Timestamps are in microseconds, kept to the nanosecond.
+            out << std::fixed << std::setprecision(3) << "{\"traceEvents\":[";
+
+            bool first = true;
+            std::size_t dropped = 0;
+
+            registry::get().for_each(
+            [&out, &first, &dropped](const buffer& b)
+            {
+                std::size_t count = b._count.load(std::memory_order_acquire);
+
+                for (std::size_t i = 0; i < count; ++i)
+                {
+                    const event& e = b._events[i];
+
+                    out << (first ? "\n" : ",\n")
+                        << "{\"name\":\"" << e._name << "\",\"cat\":\"obj\",\"ph\":\"X\""
+                        << ",\"pid\":1,\"tid\":" << b._thread
+                        << ",\"ts\":" << e._begin / 1000.0
+                        << ",\"dur\":" << (e._end - e._begin) / 1000.0
+                        << ",\"args\":{\"id\":" << e._id << ",\"parent\":" << e._parent
+                        << ",\"object\":\"" << e._object << "\"}}";
+
+                    first = false;
+                }
+
+                dropped += b._dropped.load(std::memory_order_relaxed);
+            });
+
+            out << "\n],\"otherData\":{\"dropped\":" << dropped << "}}\n";
+
+            out.flags(flags);
+            out.precision(precision);
+        }
+
+        inline void write_json(std::ostream&& out)
+        {
+            write_json(out);
+        }
+    }
+}
+
+#else
+
+#define OBJ_TRACE_SCOPE(name, object) ((void)0)
+
+#endif
+
+#endif
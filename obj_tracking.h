@@ -0,0 +1,241 @@
+//
+// obj_tracking.h
+// Passageways
+//
+// Copyright (c) 2014 Vincent Tourangeau.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+#ifndef __OBJ_TRACKING_H__
+#define __OBJ_TRACKING_H__
+
+#include <obj_dirty_set.h>
+#include <obj_property.h>
+
+#include <cstdint>
+#include <vector>
+
+namespace obj
+{
+    // Polling change tracking
+    //
+    // Tracked properties have no signals. An assignment bumps the
+    // property's version and sets its bit in the tracker it belongs to;
+    // consumers either compare versions or drain the tracker once per tick
+    // to get the slots that changed since the previous drain.
+
+    class change_tracker
+    {
+    public:
+        change_tracker() :
+            _dirty(),
+            _free(),
+            _live(),
+            _released()
+        {
+        }
+
+        std::size_t acquire()
+        {
+            std::size_t slot;
+
+            if (!_free.empty())
+            {
+                slot = _free.back();
+                _free.pop_back();
+                _live[slot] = true;
+            }
+            else
+            {
+                slot = _live.size();
+                _live.push_back(true);
+
+                if (slot >= _dirty.capacity())
+                {
+                    _dirty.resize(_live.size() * 2);
+                }
+            }
+
+            return slot;
+        }
+
+        // A pending change is dropped with the slot, so whoever acquires
+        // it next starts clean: a slot released while marked is only
+        // reused after the next drain or clear has unmarked it.
+        void release(std::size_t slot)
+        {
+            _live[slot] = false;
+
+            if (_dirty.contains(slot))
+            {
+                _released.push_back(slot);
+            }
+            else
+            {
+                _free.push_back(slot);
+            }
+        }
+
+        void mark(std::size_t slot)
+        {
+            _dirty.insert(slot);
+        }
+
+        bool changed(std::size_t slot) const
+        {
+            return _dirty.contains(slot);
+        }
+
+        bool empty() const
+        {
+            return size() == 0;
+        }
+
+        std::size_t size() const
+        {
+            return _dirty.size() - _released.size();
+        }
+
+        // Calls fn with each slot changed since the last drain, then
+        // forgets them.
+        template<class Fn>
+        void drain(Fn fn)
+        {
+            std::vector<std::size_t> released;
+
+            released.swap(_released);
+
+            _dirty.drain(
+            [this, &fn](const std::vector<std::size_t>& slots)
+            {
+                for (auto slot : slots)
+                {
+                    if (_live[slot])
+                    {
+                        fn(slot);
+                    }
+                }
+            });
+
+            _free.insert(_free.end(), released.begin(), released.end());
+        }
+
+        void clear()
+        {
+            _dirty.clear();
+            _free.insert(_free.end(), _released.begin(), _released.end());
+            _released.clear();
+        }
+
+    private:
+        change_tracker(const change_tracker&);
+
+        dirty_set                   _dirty;
+        std::vector<std::size_t>    _free;
+        std::vector<bool>           _live;
+        std::vector<std::size_t>    _released;
+    };
+
+    template<typename T, var_return_type V>
+    class basic_tracked_property : public basic_property_base<T,V>
+    {
+
+    public:
+        basic_tracked_property(const T& val = T()) :
+            basic_property_base<T,V>(val),
+            _slot(0),
+            _tracker(nullptr),
+            _version(0)
+        {
+        }
+
+        basic_tracked_property(change_tracker& tracker, const T& val = T()) :
+            basic_property_base<T,V>(val),
+            _slot(tracker.acquire()),
+            _tracker(&tracker),
+            _version(0)
+        {
+        }
+
+        basic_tracked_property(const basic_tracked_property& other) :
+            basic_property_base<T,V>(other),
+            _slot(other._tracker ? other._tracker->acquire() : 0),
+            _tracker(other._tracker),
+            _version(0)
+        {
+        }
+
+        ~basic_tracked_property()
+        {
+            if (_tracker)
+            {
+                _tracker->release(_slot);
+            }
+        }
+
+        basic_tracked_property<T,V>&
+        operator=(const basic_tracked_property& rhs)
+        {
+            return *this = rhs._val;
+        }
+
+        basic_tracked_property<T,V>&
+        operator=(const T& rhs)
+        {
+            if (!compare<T>::equal(this->_val, rhs))
+            {
+                this->_val = rhs;
+                ++_version;
+
+                if (_tracker)
+                {
+                    _tracker->mark(_slot);
+                }
+            }
+
+            return *this;
+        }
+
+        std::size_t slot() const
+        {
+            return _slot;
+        }
+
+        change_tracker* tracker() const
+        {
+            return _tracker;
+        }
+
+        std::uint64_t version() const
+        {
+            return _version;
+        }
+
+    private:
+        std::size_t     _slot;
+        change_tracker* _tracker;
+        std::uint64_t   _version;
+    };
+
+    template<typename T> using tracked_property =
+        basic_tracked_property<T, var_return_type::ref>;
+}
+
+#endif
@@ -0,0 +1,429 @@
+//
+//  obj_views.h
+//  Passageways
+//
+//  Copyright (c) 2015 Vincent Tourangeau. All rights reserved.
+//
+
+#ifndef __OBJ_VIEWS_H__
+#define __OBJ_VIEWS_H__
+
+#include <algorithm>
+#include <cstddef>
+#include <iterator>
+#include <type_traits>
+#include <utility>
+
+namespace obj
+{
+    namespace details
+    {
+        template<class C>
+        auto reserve(C& c, std::size_t size, int) -> decltype(c.reserve(size), void())
+        {
+            c.reserve(size);
+        }
+
+        template<class C>
+        void reserve(C&, std::size_t, long)
+        {
+        }
+
+        // Sorted output goes on the end: push_back where the container has
+        // it, otherwise an insert hinted at end(), which is O(1) for sets.
+        template<class C>
+        auto appender(C& c, int) -> decltype(c.push_back(*c.begin()), std::back_insert_iterator<C>(c))
+        {
+            return std::back_inserter(c);
+        }
+
+        template<class C>
+        std::insert_iterator<C> appender(C& c, long)
+        {
+            return std::inserter(c, c.end());
+        }
+    }
+
+    // Lazy views
+    //
+    // Views wrap a container or another view and compute their elements
+    // while being iterated, so a chain of them runs in a single pass with
+    // no intermediate containers. Containers passed as lvalues are held by
+    // reference and must outlive the view; temporaries are moved in.
+    //
+    //     auto ids = obj::views::to<std::vector<int>>(
+    //         people | obj::views::filter(isActive)
+    //                | obj::views::transform(getId));
+
+    namespace views
+    {
+        class view_base
+        {
+        };
+
+        namespace details
+        {
+            template<class R>
+            struct stored
+            {
+                using type = R;
+            };
+
+            template<class R>
+            struct stored<R&>
+            {
+                using type = const R&;
+            };
+
+            template<class R>
+            using iterator_of =
+                decltype(std::declval<const typename std::remove_reference<R>::type&>().begin());
+
+            // Whether the size of a range is known without walking it, and
+            // the size if it is.
+            template<class R>
+            auto size_of(const R& r, int) -> decltype(r.sized(), std::pair<bool, std::size_t>())
+            {
+                return std::make_pair(r.sized(), r.sized() ? r.size() : 0);
+            }
+
+            template<class R>
+            auto size_of(const R& r, long) -> decltype(r.size(), std::pair<bool, std::size_t>())
+            {
+                return std::make_pair(true, static_cast<std::size_t>(r.size()));
+            }
+
+            template<class R>
+            std::pair<bool, std::size_t> size_of(const R&, ...)
+            {
+                return std::make_pair(false, std::size_t(0));
+            }
+
+            struct first
+            {
+                template<class P>
+                auto operator()(const P& p) const -> decltype((p.first))
+                {
+                    return p.first;
+                }
+            };
+
+            struct second
+            {
+                template<class P>
+                auto operator()(const P& p) const -> decltype((p.second))
+                {
+                    return p.second;
+                }
+            };
+        }
+
+        template<class R, class Fn>
+        class transform_view : public view_base
+        {
+        public:
+            using base_iterator = details::iterator_of<R>;
+            using reference = decltype(std::declval<const Fn&>()(*std::declval<base_iterator>()));
+            using value_type = typename std::decay<reference>::type;
+
+            class iterator
+            {
+            public:
+                using iterator_category = std::forward_iterator_tag;
+                using value_type = typename transform_view::value_type;
+                using difference_type = std::ptrdiff_t;
+                using pointer = const value_type*;
+                using reference = typename transform_view::reference;
+
+                iterator() :
+                    _fn(nullptr),
+                    _it()
+                {
+                }
+
+                iterator(base_iterator it, const Fn* fn) :
+                    _fn(fn),
+                    _it(it)
+                {
+                }
+
+                reference operator*() const
+                {
+                    return (*_fn)(*_it);
+                }
+
+                iterator& operator++()
+                {
+                    ++_it;
+
+                    return *this;
+                }
+
+                iterator operator++(int)
+                {
+                    iterator result(*this);
+                    ++_it;
+
+                    return result;
+                }
+
+                bool operator==(const iterator& rhs) const
+                {
+                    return _it == rhs._it;
+                }
+
+                bool operator!=(const iterator& rhs) const
+                {
+                    return _it != rhs._it;
+                }
+
+            private:
+                const Fn*       _fn;
+                base_iterator   _it;
+            };
+
+            using const_iterator = iterator;
+
+            transform_view(R range, Fn fn) :
+                _fn(fn),
+                _range(std::forward<R>(range))
+            {
+            }
+
+            iterator begin() const
+            {
+                return iterator(_range.begin(), &_fn);
+            }
+
+            iterator end() const
+            {
+                return iterator(_range.end(), &_fn);
+            }
+
+            bool sized() const
+            {
+                return details::size_of(_range, 0).first;
+            }
+
+            std::size_t size() const
+            {
+                return details::size_of(_range, 0).second;
+            }
+
+        private:
+            Fn  _fn;
+            R   _range;
+        };
+
+        // Dereferences each element once for the predicate and again when
+        // it is read, so over a transform_view the function runs twice for
+        // the elements kept.
+        template<class R, class Pred>
+        class filter_view : public view_base
+        {
+        public:
+            using base_iterator = details::iterator_of<R>;
+            using reference = decltype(*std::declval<base_iterator>());
+            using value_type = typename std::decay<reference>::type;
+
+            class iterator
+            {
+            public:
+                using iterator_category = std::forward_iterator_tag;
+                using value_type = typename filter_view::value_type;
+                using difference_type = std::ptrdiff_t;
+                using pointer = const value_type*;
+                using reference = typename filter_view::reference;
+
+                iterator() :
+                    _end(),
+                    _it(),
+                    _pred(nullptr)
+                {
+                }
+
+                iterator(base_iterator it, base_iterator end, const Pred* pred) :
+                    _end(end),
+                    _it(it),
+                    _pred(pred)
+                {
+                    skip();
+                }
+
+                reference operator*() const
+                {
+                    return *_it;
+                }
+
+                iterator& operator++()
+                {
+                    ++_it;
+                    skip();
+
+                    return *this;
+                }
+
+                iterator operator++(int)
+                {
+                    iterator result(*this);
+                    ++*this;
+
+                    return result;
+                }
+
+                bool operator==(const iterator& rhs) const
+                {
+                    return _it == rhs._it;
+                }
+
+                bool operator!=(const iterator& rhs) const
+                {
+                    return _it != rhs._it;
+                }
+
+            private:
+                void skip()
+                {
+                    while (_it != _end && !(*_pred)(*_it))
+                    {
+                        ++_it;
+                    }
+                }
+
+                base_iterator   _end;
+                base_iterator   _it;
+                const Pred*     _pred;
+            };
+
+            using const_iterator = iterator;
+
+            filter_view(R range, Pred pred) :
+                _pred(pred),
+                _range(std::forward<R>(range))
+            {
+            }
+
+            iterator begin() const
+            {
+                return iterator(_range.begin(), _range.end(), &_pred);
+            }
+
+            iterator end() const
+            {
+                return iterator(_range.end(), _range.end(), &_pred);
+            }
+
+            bool sized() const
+            {
+                return false;
+            }
+
+            std::size_t size() const
+            {
+                return 0;
+            }
+
+        private:
+            Pred    _pred;
+            R       _range;
+        };
+
+        template<class R, class Fn>
+        transform_view<typename details::stored<R>::type, Fn>
+        transform(R&& range, Fn fn)
+        {
+            return transform_view<typename details::stored<R>::type, Fn>(std::forward<R>(range), fn);
+        }
+
+        template<class R, class Pred>
+        filter_view<typename details::stored<R>::type, Pred>
+        filter(R&& range, Pred pred)
+        {
+            return filter_view<typename details::stored<R>::type, Pred>(std::forward<R>(range), pred);
+        }
+
+        template<class M>
+        transform_view<typename details::stored<M>::type, details::first>
+        keys(M&& map)
+        {
+            return transform(std::forward<M>(map), details::first());
+        }
+
+        template<class M>
+        transform_view<typename details::stored<M>::type, details::second>
+        values(M&& map)
+        {
+            return transform(std::forward<M>(map), details::second());
+        }
+
+        // Materializes a range into C, reserving once when the size is known.
+        template<class C, class R>
+        C to(const R& range)
+        {
+            C result;
+
+            std::pair<bool, std::size_t> size = details::size_of(range, 0);
+
+            if (size.first)
+            {
+                obj::details::reserve(result, size.second, 0);
+            }
+
+            std::copy(range.begin(), range.end(), obj::details::appender(result, 0));
+
+            return result;
+        }
+
+        // Pipe adaptors: range | transform(fn) | filter(pred) | ...
+
+        template<class Fn>
+        struct transform_adaptor
+        {
+            Fn _fn;
+        };
+
+        template<class Pred>
+        struct filter_adaptor
+        {
+            Pred _pred;
+        };
+
+        template<class Fn>
+        transform_adaptor<Fn> transform(Fn fn)
+        {
+            return transform_adaptor<Fn>{fn};
+        }
+
+        template<class Pred>
+        filter_adaptor<Pred> filter(Pred pred)
+        {
+            return filter_adaptor<Pred>{pred};
+        }
+
+        inline transform_adaptor<details::first> keys()
+        {
+            return transform_adaptor<details::first>{details::first()};
+        }
+
+        inline transform_adaptor<details::second> values()
+        {
+            return transform_adaptor<details::second>{details::second()};
+        }
+
+        template<class R, class Fn>
+        transform_view<typename details::stored<R>::type, Fn>
+        operator|(R&& range, const transform_adaptor<Fn>& adaptor)
+        {
+            return transform(std::forward<R>(range), adaptor._fn);
+        }
+
+        template<class R, class Pred>
+        filter_view<typename details::stored<R>::type, Pred>
+        operator|(R&& range, const filter_adaptor<Pred>& adaptor)
+        {
+            return filter(std::forward<R>(range), adaptor._pred);
+        }
+    }
+}
+
+#endif
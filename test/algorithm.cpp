@@ -0,0 +1,124 @@
+//
+// algorithm.cpp
+// Passageways
+//
+// Checks for obj_algorithm.h. Exits non-zero on the first failure.
+//
+//     g++ -std=c++11 -I.. algorithm.cpp -o algorithm && ./algorithm
+//
+
+#include <obj_algorithm.h>
+
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+#define CHECK(cond) \
+    do \
+    { \
+        if (!(cond)) \
+        { \
+            std::fprintf(stderr, "%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #cond); \
+            std::exit(1); \
+        } \
+    } while (0)
+
+namespace
+{
+    void transform_and_copy_if_calls_fn_once()
+    {
+        std::vector<int> source = { 1, 2, 3, 4, 5, 6 };
+        int calls = 0;
+
+        auto result = obj::transform_and_copy_if<std::vector<int>>(source,
+        [&calls](int x)
+        {
+            ++calls;
+            return x * 10;
+        },
+        [](int x)
+        {
+            return x != 30;
+        });
+
+        CHECK(calls == 6);
+        CHECK(result == std::vector<int>({ 10, 20, 40, 50, 60 }));
+    }
+
+    void set_intersection_keeps_duplicates_of_vectors()
+    {
+        std::vector<int> a = { 1, 1, 1, 2, 5, 6, 7, 8 };
+        std::vector<int> b = { 1, 3, 4, 5, 6, 9, 10, 11 };
+
+        CHECK(obj::set_intersection(a, b) == std::vector<int>({ 1, 5, 6 }));
+
+        std::vector<int> c = { 1, 1, 5 };
+
+        CHECK(obj::set_intersection(a, c) == std::vector<int>({ 1, 1, 5 }));
+    }
+
+    void set_difference_in_place_removes_one_per_match()
+    {
+        std::vector<int> a = { 1, 1, 2 };
+
+        obj::set_difference_in_place(a, std::vector<int>({ 1 }));
+
+        CHECK(a == std::vector<int>({ 1, 2 }));
+
+        std::vector<int> b = { 1, 1, 1, 3, 3 };
+
+        obj::set_difference_in_place(b, std::vector<int>({ 1, 1, 3, 4 }));
+
+        CHECK(b == std::vector<int>({ 1, 3 }));
+    }
+
+    void set_union_in_place_keeps_the_larger_multiplicity()
+    {
+        std::vector<int> a = { 1, 3 };
+
+        obj::set_union_in_place(a, std::vector<int>({ 1, 1, 3 }));
+
+        CHECK(a == std::vector<int>({ 1, 1, 3 }));
+
+        std::vector<int> b = { 1, 1, 2, 5 };
+
+        obj::set_union_in_place(b, std::vector<int>({ 0, 1, 2, 2, 2, 6 }));
+
+        CHECK(b == std::vector<int>({ 0, 1, 1, 2, 2, 2, 5, 6 }));
+    }
+
+    void set_intersection_of_flat_sets()
+    {
+        obj::flat_set<int> a;
+        obj::flat_set<int> b;
+
+        for (int i = 0; i < 1000; ++i)
+        {
+            a.insert(i * 2);
+            b.insert(i * 3);
+        }
+
+        std::vector<int> out;
+        obj::set_intersection_into(a, b, out);
+
+        CHECK(out.size() == 334);
+
+        for (std::size_t i = 0; i < out.size(); ++i)
+        {
+            CHECK(out[i] == static_cast<int>(i) * 6);
+        }
+    }
+}
+
+int main()
+{
+    transform_and_copy_if_calls_fn_once();
+    set_intersection_keeps_duplicates_of_vectors();
+    set_difference_in_place_removes_one_per_match();
+    set_union_in_place_keeps_the_larger_multiplicity();
+    set_intersection_of_flat_sets();
+
+    std::printf("ok\n");
+
+    return 0;
+}